@@ -0,0 +1,115 @@
+#!/usr/bin/perl
+# Runs the original and the rewritten doxygen on the same inputs and fails
+# when the rewritten one is slower, uses more memory, or writes other output.
+#
+#   bench.pl --before <doxygen> --after <doxygen> [options] <Doxyfile>...
+#
+#   --runs N             repetitions per doxygen and input, medians are compared (5)
+#   --threshold PCT      allowed wall time regression in percent (5)
+#   --rss-threshold PCT  allowed peak RSS regression in percent (10)
+#   --set TAG=VALUE      extra configuration for both, may repeat
+#
+# Every run gets its own OUTPUT_DIRECTORY, the outputs of the last runs are
+# compared with diff -r. Timestamps are switched off so they can be equal.
+use strict;
+use warnings;
+
+use Cwd qw(abs_path);
+use File::Basename qw(dirname);
+use File::Path qw(make_path remove_tree);
+use File::Temp qw(tempdir);
+use Getopt::Long;
+
+my ($before, $after);
+my $runs = 5;
+my $threshold = 5;
+my $rss_threshold = 10;
+my @set = ('HTML_TIMESTAMP=NO', 'LATEX_TIMESTAMP=NO', 'QUIET=YES');
+
+GetOptions('before=s'        => \$before,
+           'after=s'         => \$after,
+           'runs=i'          => \$runs,
+           'threshold=f'     => \$threshold,
+           'rss-threshold=f' => \$rss_threshold,
+           'set=s'           => \@set)
+  and $before and $after and @ARGV and $runs > 0
+  or die "usage: $0 --before <doxygen> --after <doxygen> [--runs N] [--threshold PCT] [--rss-threshold PCT] [--set TAG=VALUE] <Doxyfile>...\n";
+
+-x '/usr/bin/time' or die "$0: needs /usr/bin/time for the peak RSS\n";
+$before = abs_path($before);
+$after  = abs_path($after);
+
+my $tmp = tempdir('doxygen-bench-XXXXXX', TMPDIR => 1, CLEANUP => 1);
+my $failed = 0;
+
+sub median {
+   my @v = sort { $a <=> $b } @_;
+   return @v % 2 ? $v[$#v / 2] : ($v[@v / 2 - 1] + $v[@v / 2]) / 2;
+}
+
+# runs doxygen on the Doxyfile with the output in $out, returns (seconds, KiB)
+sub run {
+   my ($doxygen, $doxyfile, $out) = @_;
+   remove_tree($out);
+   make_path($out);
+   open(my $cfg, '<', $doxyfile) or die "$doxyfile: $!\n";
+   my $config = do { local $/; <$cfg> };
+   close($cfg);
+   $config .= "\n$_\n" for (@set, "OUTPUT_DIRECTORY=$out", "WARN_LOGFILE=$out.warnings");
+
+   # doxygen resolves the paths of a Doxyfile relative to the working directory
+   my $time = "$out.time";
+   my $pid = open(my $pipe, '|-');
+   defined $pid or die "fork: $!\n";
+   if (!$pid) {
+      chdir(dirname($doxyfile)) or die "$doxyfile: $!\n";
+      open(STDOUT, '>', "$out.log");
+      exec('/usr/bin/time', '-f', '%e %M', '-o', $time, $doxygen, '-') or die "$doxygen: $!\n";
+   }
+   print $pipe $config;
+   close($pipe) or die "$doxygen failed on $doxyfile, see $out.log\n";
+
+   open(my $t, '<', $time) or die "$time: $!\n";
+   my @last = split(' ', (<$t>)[-1]);
+   close($t);
+   return @last;
+}
+
+sub change {
+   my ($old, $new) = @_;
+   return $old > 0 ? 100 * ($new - $old) / $old : 0;
+}
+
+for my $doxyfile (map { abs_path($_) } @ARGV) {
+   my %time = (before => [], after => []);
+   my %rss  = (before => [], after => []);
+   # alternating the two spreads any drift of the machine over both
+   for my $i (1 .. $runs) {
+      for my $which ('before', 'after') {
+         my ($s, $kb) = run($which eq 'before' ? $before : $after, $doxyfile, "$tmp/input/$which");
+         push @{$time{$which}}, $s;
+         push @{$rss{$which}}, $kb;
+      }
+   }
+   my ($t0, $t1) = (median(@{$time{before}}), median(@{$time{after}}));
+   my ($m0, $m1) = (median(@{$rss{before}}), median(@{$rss{after}}));
+   printf("%s\n", $doxyfile);
+   printf("  wall time  %8.2f s  -> %8.2f s   %+6.1f%%\n", $t0, $t1, change($t0, $t1));
+   printf("  peak RSS   %8d KiB -> %8d KiB %+6.1f%%\n", $m0, $m1, change($m0, $m1));
+
+   if (change($t0, $t1) > $threshold) {
+      print "  FAIL: wall time regressed more than $threshold%\n";
+      $failed = 1;
+   }
+   if (change($m0, $m1) > $rss_threshold) {
+      print "  FAIL: peak RSS regressed more than $rss_threshold%\n";
+      $failed = 1;
+   }
+   if (system('diff', '-r', '-q', "$tmp/input/before", "$tmp/input/after") != 0) {
+      print "  FAIL: output differs\n";
+      $failed = 1;
+   }
+   remove_tree("$tmp/input");
+}
+
+exit $failed;
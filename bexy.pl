@@ -13,5 +13,8 @@ while (<>) {              # Read input into default variable $_
    if (m/\@X(.*),(.*)\@Y/) {
         s/\@X(.*),(.*)\@Y/$2!=${it_decl}end() && ($1=*$2)/gi;
    }
+   if (m/\@O(.*),(.*)\@Y/) {
+        s/\@O(.*),(.*)\@Y/$2!=${it_decl}end() && ($1=$2->get())/gi;
+   }
    print $_;
 }
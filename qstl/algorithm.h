@@ -0,0 +1,59 @@
+//    Helpers for code translated by refactor from QList<T> to std::list<T*>
+//    and std::list<std::unique_ptr<T>>. Copied next to the rewritten doxygen sources.
+
+#ifndef QSTL_ALGORITHM_H
+#define QSTL_ALGORITHM_H
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+
+namespace qstl {
+
+// owning and non-owning lists compare their elements as plain pointers
+template<class T> T *rawPointer(T *p)                          { return p; }
+template<class T> T *rawPointer(const std::unique_ptr<T> &p)   { return p.get(); }
+
+template<class List, class T>
+typename List::iterator find(List &list, const T *item) {
+  return std::find_if(list.begin(), list.end(), [item](const typename List::value_type &e) { return rawPointer(e) == item; });
+}
+
+template<class List, class T>
+typename List::const_iterator find(const List &list, const T *item) {
+  return std::find_if(list.begin(), list.end(), [item](const typename List::value_type &e) { return rawPointer(e) == item; });
+}
+
+// QList::remove(item), QList::removeRef(item): the first occurrence only,
+// false when the item is not in the list
+template<class List, class T>
+bool eraseFirst(List &list, const T *item) {
+  auto it = find(list, item);
+  if (it == list.end()) return false;
+  list.erase(it);
+  return true;
+}
+
+// QList::remove(index): false when the index is out of range
+template<class List>
+bool eraseAt(List &list, long index) {
+  if (index < 0 || static_cast<unsigned long>(index) >= list.size()) return false;
+  list.erase(std::next(list.begin(), index));
+  return true;
+}
+
+// QList::findRef(item): index of the first occurrence, -1 when not found
+template<class List, class T>
+int indexOf(const List &list, const T *item) {
+  auto it = find(list, item);
+  return it == list.end() ? -1 : static_cast<int>(std::distance(list.begin(), it));
+}
+
+template<class List, class T>
+bool contains(const List &list, const T *item) {
+  return find(list, item) != list.end();
+}
+
+} // namespace qstl
+
+#endif
@@ -0,0 +1,32 @@
+//    Arena for the std::pmr containers refactor emits for the declarations
+//    marked pmr in -backend-sites. Copied next to the rewritten doxygen sources.
+//
+//    The containers doxygen fills while parsing live until it exits, so their
+//    nodes come from one monotonic_buffer_resource: an allocation is a pointer
+//    bump and nothing is given back before exit. A container that keeps
+//    erasing and inserting grows the arena instead, don't mark those.
+//
+//    monotonic_buffer_resource is not thread-safe: only mark containers that
+//    doxygen's worker threads never touch.
+
+#ifndef QSTL_ARENA_H
+#define QSTL_ARENA_H
+
+// std::pmr needs C++17, the rest of the rewritten sources do not
+#if __cplusplus >= 201703L
+
+#include <memory_resource>
+
+namespace qstl {
+
+inline std::pmr::memory_resource *arena() {
+  // never destroyed, containers with static storage may be destroyed after it
+  static std::pmr::monotonic_buffer_resource *resource = new std::pmr::monotonic_buffer_resource(1 << 20);
+  return resource;
+}
+
+} // namespace qstl
+
+#endif
+
+#endif
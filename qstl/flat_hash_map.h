@@ -0,0 +1,312 @@
+//    Open addressing hash map for code translated by refactor from QDict<T>
+//    and QIntDict<T> (-dict-backend=flat). Copied next to the rewritten doxygen sources.
+//
+//    The entries live in one array probed linearly, next to an array of one
+//    byte per slot holding 7 bits of the hash, so a lookup compares keys only
+//    for slots whose byte matches and never follows a pointer per entry.
+//    Erased slots become tombstones until the next rehash, which keeps
+//    iterators valid across erase() like std::unordered_map.
+//
+//    Differences from std::unordered_map: value_type is std::pair<Key, T>
+//    (the key must not be changed through an iterator), and insertions
+//    invalidate iterators and references when they grow the table.
+
+#ifndef QSTL_FLAT_HASH_MAP_H
+#define QSTL_FLAT_HASH_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace qstl {
+
+// 8 bytes per step, the last word overlaps the one before instead of being
+// copied byte by byte; the table scrambles the result once more, see flat_hash_map::slot()
+inline uint64_t hashWord(const char *p) {
+  uint64_t w;
+  std::memcpy(&w, p, 8);
+  return w;
+}
+
+inline uint64_t hashBytes(const char *data, size_t len) {
+  const uint64_t k = 0x9E3779B97F4A7C15ull;
+  uint64_t h = len * k;
+  if (len >= 8) {
+    const char *last = data + len - 8;
+    for (; data < last; data += 8) h = ((h << 5 | h >> 59) ^ hashWord(data)) * k;
+    h = ((h << 5 | h >> 59) ^ hashWord(last)) * k;
+  } else if (len >= 4) {
+    uint32_t lo, hi;
+    std::memcpy(&lo, data, 4);
+    std::memcpy(&hi, data + len - 4, 4);
+    h = (h ^ (uint64_t(hi) << 32 | lo)) * k;
+  } else if (len > 0) {
+    h = (h ^ (uint64_t(uint8_t(data[0])) << 16 | uint64_t(uint8_t(data[len / 2])) << 8 | uint8_t(data[len - 1]))) * k;
+  }
+  return h ^ (h >> 29);
+}
+
+template<class Key, class Enable = void>
+struct hash {
+  size_t operator()(const Key &key) const { return std::hash<Key>()(key); }
+};
+
+template<>
+struct hash<std::string> {
+  size_t operator()(const std::string &key) const { return hashBytes(key.data(), key.size()); }
+  size_t operator()(const char *key) const        { return hashBytes(key, std::strlen(key)); }
+};
+
+// integer keys are used as they are, the multiplication in slot() spreads them
+template<class Key>
+struct hash<Key, typename std::enable_if<std::is_integral<Key>::value || std::is_enum<Key>::value>::type> {
+  size_t operator()(Key key) const { return static_cast<size_t>(key); }
+};
+
+template<class Key, class T, class Hash = qstl::hash<Key>>
+class flat_hash_map {
+public:
+  typedef Key key_type;
+  typedef T mapped_type;
+  typedef std::pair<Key, T> value_type;
+  typedef size_t size_type;
+  typedef value_type &reference;
+  typedef const value_type &const_reference;
+
+private:
+  enum : uint8_t { Empty = 0, Deleted = 1 }; // a full slot has the top bit set
+
+  template<class Value, class Map>
+  class basic_iterator {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef typename flat_hash_map::value_type value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef Value *pointer;
+    typedef Value &reference;
+
+    basic_iterator() : m_map(nullptr), m_index(0) {}
+    // iterator -> const_iterator
+    template<class V, class M>
+    basic_iterator(const basic_iterator<V, M> &it) : m_map(it.m_map), m_index(it.m_index) {}
+
+    reference operator*() const  { return m_map->m_slots[m_index]; }
+    pointer operator->() const   { return &m_map->m_slots[m_index]; }
+    basic_iterator &operator++() { m_index = m_map->next(m_index + 1); return *this; }
+    basic_iterator operator++(int) { basic_iterator it = *this; ++*this; return it; }
+    bool operator==(const basic_iterator &it) const { return m_index == it.m_index; }
+    bool operator!=(const basic_iterator &it) const { return m_index != it.m_index; }
+
+  private:
+    friend class flat_hash_map;
+    template<class V, class M> friend class basic_iterator;
+    basic_iterator(Map *map, size_t index) : m_map(map), m_index(index) {}
+
+    Map *m_map;
+    size_t m_index;
+  };
+
+public:
+  typedef basic_iterator<value_type, flat_hash_map> iterator;
+  typedef basic_iterator<const value_type, const flat_hash_map> const_iterator;
+
+  flat_hash_map() {}
+  explicit flat_hash_map(size_type n) { reserve(n); }
+  flat_hash_map(const flat_hash_map &other) {
+    reserve(other.size());
+    for (const auto &entry : other) insert(entry);
+  }
+  flat_hash_map(flat_hash_map &&other) noexcept { swap(other); }
+  flat_hash_map &operator=(flat_hash_map other) { swap(other); return *this; }
+  ~flat_hash_map() { destroy(); }
+
+  void swap(flat_hash_map &other) noexcept {
+    std::swap(m_ctrl, other.m_ctrl);
+    std::swap(m_slots, other.m_slots);
+    std::swap(m_capacity, other.m_capacity);
+    std::swap(m_shift, other.m_shift);
+    std::swap(m_size, other.m_size);
+    std::swap(m_used, other.m_used);
+  }
+
+  iterator begin()              { return iterator(this, next(0)); }
+  iterator end()                { return iterator(this, m_capacity); }
+  const_iterator begin() const  { return const_iterator(this, next(0)); }
+  const_iterator end() const    { return const_iterator(this, m_capacity); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const   { return end(); }
+
+  bool empty() const      { return m_size == 0; }
+  size_type size() const  { return m_size; }
+
+  void clear() {
+    for (size_t i = 0; i < m_capacity; ++i) {
+      if (m_ctrl[i] & 0x80) m_slots[i].~value_type();
+      m_ctrl[i] = Empty;
+    }
+    m_size = m_used = 0;
+  }
+
+  // room for n entries without a rehash
+  void reserve(size_type n) {
+    size_t capacity = 8;
+    while (capacity - capacity / 4 < n) capacity *= 2;
+    if (capacity > m_capacity) rehash(capacity);
+  }
+
+  iterator find(const Key &key)             { return iterator(this, lookup(key)); }
+  const_iterator find(const Key &key) const { return const_iterator(this, lookup(key)); }
+  size_type count(const Key &key) const     { return lookup(key) != m_capacity; }
+  bool contains(const Key &key) const       { return lookup(key) != m_capacity; }
+
+  T &at(const Key &key) {
+    size_t i = lookup(key);
+    if (i == m_capacity) throw std::out_of_range("qstl::flat_hash_map::at");
+    return m_slots[i].second;
+  }
+  const T &at(const Key &key) const { return const_cast<flat_hash_map*>(this)->at(key); }
+
+  T &operator[](const Key &key) { return try_emplace(key).first->second; }
+  T &operator[](Key &&key)      { return try_emplace(std::move(key)).first->second; }
+
+  template<class K, class... Args>
+  std::pair<iterator, bool> try_emplace(K &&key, Args&&... args) {
+    size_t h = Hash()(key);
+    size_t i = lookup(key, h);
+    if (i != m_capacity) return std::make_pair(iterator(this, i), false);
+    i = insertSlot(h);
+    new (&m_slots[i]) value_type(std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                                 std::forward_as_tuple(std::forward<Args>(args)...));
+    return std::make_pair(iterator(this, i), true);
+  }
+
+  std::pair<iterator, bool> insert(const value_type &value) { return try_emplace(value.first, value.second); }
+  std::pair<iterator, bool> insert(value_type &&value)      { return try_emplace(std::move(value.first), std::move(value.second)); }
+
+  template<class... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) { return insert(value_type(std::forward<Args>(args)...)); }
+
+  template<class K, class V>
+  std::pair<iterator, bool> insert_or_assign(K &&key, V &&value) {
+    auto result = try_emplace(std::forward<K>(key), std::forward<V>(value));
+    if (!result.second) result.first->second = std::forward<V>(value);
+    return result;
+  }
+
+  size_type erase(const Key &key) {
+    size_t i = lookup(key);
+    if (i == m_capacity) return 0;
+    eraseSlot(i);
+    return 1;
+  }
+  iterator erase(const_iterator it) {
+    eraseSlot(it.m_index);
+    return iterator(this, next(it.m_index + 1));
+  }
+
+private:
+  // Fibonacci hashing: the top bits of the product depend on all bits of h
+  static uint64_t scramble(size_t h) { return uint64_t(h) * 0x9E3779B97F4A7C15ull; }
+  size_t slot(size_t h) const { return static_cast<size_t>(scramble(h) >> m_shift); }
+  // the 7 bits below those of the slot
+  uint8_t tag(size_t h) const { return 0x80 | ((scramble(h) >> (m_shift - 7)) & 0x7f); }
+
+  size_t next(size_t i) const {
+    while (i < m_capacity && !(m_ctrl[i] & 0x80)) ++i;
+    return i;
+  }
+
+  template<class K>
+  size_t lookup(const K &key) const { return lookup(key, Hash()(key)); }
+
+  template<class K>
+  size_t lookup(const K &key, size_t h) const {
+    if (m_size == 0) return m_capacity;
+    const uint8_t t = tag(h);
+    const size_t mask = m_capacity - 1;
+    for (size_t i = slot(h); ; i = (i + 1) & mask) {
+      if (m_ctrl[i] == t && m_slots[i].first == key) return i;
+      if (m_ctrl[i] == Empty) return m_capacity;
+    }
+  }
+
+  // a free slot for a key known not to be in the table
+  size_t insertSlot(size_t h) {
+    if (m_used + 1 > m_capacity - m_capacity / 4) {
+      // mostly tombstones: same size, otherwise grow
+      rehash(m_size + 1 > m_capacity / 2 ? m_capacity * 2 : m_capacity);
+    }
+    const size_t mask = m_capacity - 1;
+    size_t i = slot(h);
+    while (m_ctrl[i] & 0x80) i = (i + 1) & mask;
+    if (m_ctrl[i] == Empty) ++m_used;
+    m_ctrl[i] = tag(h);
+    ++m_size;
+    return i;
+  }
+
+  void eraseSlot(size_t i) {
+    m_slots[i].~value_type();
+    // a slot followed by an empty one ends no probe sequence and can be empty again
+    if (m_ctrl[(i + 1) & (m_capacity - 1)] == Empty) {
+      m_ctrl[i] = Empty;
+      --m_used;
+    } else {
+      m_ctrl[i] = Deleted;
+    }
+    --m_size;
+  }
+
+  void rehash(size_t capacity) {
+    if (capacity < 8) capacity = 8;
+    flat_hash_map old;
+    swap(old);
+    m_ctrl = new uint8_t[capacity]();
+    m_slots = static_cast<value_type*>(::operator new(capacity * sizeof(value_type)));
+    m_capacity = capacity;
+    m_shift = 64;
+    for (size_t c = capacity; c > 1; c >>= 1) --m_shift;
+    for (size_t i = 0; i < old.m_capacity; ++i) {
+      if (old.m_ctrl[i] & 0x80) {
+        size_t h = Hash()(old.m_slots[i].first);
+        size_t j = slot(h);
+        while (m_ctrl[j] & 0x80) j = (j + 1) & (capacity - 1);
+        m_ctrl[j] = tag(h);
+        new (&m_slots[j]) value_type(std::move(old.m_slots[i]));
+        ++m_size;
+        ++m_used;
+      }
+    }
+  }
+
+  void destroy() {
+    if (m_ctrl == nullptr) {
+      return;
+    }
+    clear();
+    delete[] m_ctrl;
+    ::operator delete(m_slots);
+    m_ctrl = nullptr;
+    m_slots = nullptr;
+    m_capacity = 0;
+  }
+
+  uint8_t *m_ctrl = nullptr;
+  value_type *m_slots = nullptr;
+  size_t m_capacity = 0;
+  unsigned m_shift = 64;
+  size_t m_size = 0;
+  size_t m_used = 0;       // full slots and tombstones
+};
+
+} // namespace qstl
+
+#endif
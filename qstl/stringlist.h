@@ -0,0 +1,61 @@
+//    Helpers for code translated by refactor from QStringList to
+//    std::vector<std::string>. Copied next to the rewritten doxygen sources.
+
+#ifndef QSTL_STRINGLIST_H
+#define QSTL_STRINGLIST_H
+
+#include <string>
+#include <vector>
+
+#include <qstring.h>
+#include <qcstring.h>
+
+namespace qstl {
+
+// element conversion for push_back(): QString/QCString/char* -> std::string
+inline std::string toStd(const char *s)         { return s ? std::string(s) : std::string(); }
+inline std::string toStd(const QCString &s)     { return toStd(s.data()); }
+inline std::string toStd(const QString &s)      { return toStd(s.utf8().data()); }
+inline std::string toStd(const QChar &c)        { return toStd(QString(c)); }
+inline const std::string &toStd(const std::string &s) { return s; }
+
+// element reads where the code still expects a QString: *it, front(), back(), list[i]
+inline QString fromStd(const std::string &s)    { return QString::fromUtf8(s.c_str()); }
+
+// QStringList::split(sep, str, allowEmptyEntries)
+template<class Sep, class Str>
+std::vector<std::string> split(const Sep &sep, const Str &str, bool allowEmptyEntries=false) {
+  const std::string &s = toStd(str);
+  const std::string &d = toStd(sep);
+  std::vector<std::string> result;
+  if (d.empty()) {
+    if (allowEmptyEntries || !s.empty()) result.push_back(s);
+    return result;
+  }
+  std::string::size_type begin = 0, end;
+  while ((end = s.find(d, begin)) != std::string::npos) {
+    if (allowEmptyEntries || end > begin) result.push_back(s.substr(begin, end - begin));
+    begin = end + d.size();
+  }
+  if (allowEmptyEntries || begin < s.size()) result.push_back(s.substr(begin));
+  return result;
+}
+
+// QStringList::join(sep), one allocation for the whole result
+template<class Sep>
+QString join(const std::vector<std::string> &list, const Sep &sep) {
+  const std::string &d = toStd(sep);
+  std::string::size_type size = 0;
+  for (const auto &s : list) size += s.size() + d.size();
+  std::string result;
+  result.reserve(size);
+  for (std::vector<std::string>::size_type i = 0; i < list.size(); i++) {
+    if (i) result += d;
+    result += list[i];
+  }
+  return QString::fromUtf8(result.c_str());
+}
+
+} // namespace qstl
+
+#endif // QSTL_STRINGLIST_H
@@ -15,7 +15,10 @@
 
 #include <stddef.h>
 
+#include "clang/AST/ASTContext.h"
 #include "clang/AST/Decl.h"
+#include "clang/AST/ExprCXX.h"
+#include "clang/AST/RecursiveASTVisitor.h"
 #include "clang/ASTMatchers/ASTMatchers.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
 #include "clang/Basic/SourceManager.h"
@@ -32,9 +35,12 @@
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
+#include <map>
 #include <system_error>
 #include <regex>
 #include <unordered_set>
+#include <vector>
 
 using namespace clang;
 using namespace clang::ast_matchers;
@@ -45,9 +51,31 @@ using clang::tooling::CompilationDatabase;
 
 cl::opt<std::string>  BuildPath(cl::Positional, cl::desc("<build-path>"));
 cl::list<std::string> SourcePaths(cl::Positional, cl::desc("<source0> [... <sourceN>]"), cl::OneOrMore);
+enum MapBackend { StdMap, FlatMap };
+cl::opt<MapBackend>   DictBackend("dict-backend", cl::desc("translation of QDict<T>"), cl::init(StdMap),
+    cl::values(clEnumValN(StdMap,  "std",  "std::unordered_map<std::string, T*>"),
+               clEnumValN(FlatMap, "flat", "qstl::flat_hash_map<std::string, T*> (qstl/flat_hash_map.h)"), clEnumValEnd));
+cl::opt<MapBackend>   IntDictBackend("intdict-backend", cl::desc("translation of QIntDict<T> fields, off unless given: their calls are not translated yet"), cl::init(StdMap),
+    cl::values(clEnumValN(StdMap,  "std",  "std::unordered_map<long, T*>"),
+               clEnumValN(FlatMap, "flat", "qstl::flat_hash_map<long, T*> (qstl/flat_hash_map.h)"), clEnumValEnd));
+cl::opt<std::string>  BackendSites("backend-sites", cl::desc("'file:line std|flat|pmr...' lines overriding -dict-backend and -intdict-backend per declaration, pmr puts a list or std map on qstl::arena()"), cl::value_desc("file"));
+cl::opt<double>       FlatLookupRatio("flat-lookup-ratio", cl::desc("with -profile, use flat for the dictionaries with at least this many lookups per insert"), cl::init(0));
+cl::opt<std::string>  ProfilePath("profile", cl::desc("container usage written by a doxygen built with 'make p'"), cl::value_desc("tsv"));
 
 std::unordered_set<const FieldDecl*> g_unique_fdecl;
 std::unordered_set<const RecordDecl*> g_unique_recorddecl;
+// declarations (see declKey) of containers that own their elements,
+// filled by the collecting pass before any replacement is made
+std::unordered_set<std::string> g_owning_decl;
+// declarations that also get setAutoDelete(FALSE) or a computed argument,
+// their elements stay raw pointers
+std::unordered_set<std::string> g_not_owning_decl;
+// pointers and references to a list (see declKey) -> the lists, and the
+// classes of the lists, they get bound to: an alias takes their element type
+std::map<std::string, std::vector<std::string>> g_list_alias;
+// iterators and loop variables (see declKey) and their references (see
+// locKey) that disappear or get redeclared when a loop becomes a range-based for
+std::unordered_set<std::string> g_range_for_refs;
 
 static std::string getText(const SourceManager &SourceManager,
                           SourceLocation StartSpellingLocation,
@@ -110,6 +138,292 @@ bool findNreplace(std::string& str, const std::string& rgx, const std::string& f
   return false;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Returns file:line:col of 'loc'. Unlike a node pointer this is the same
+// in every translation unit and in every template instantiation.
+////////////////////////////////////////////////////////////////////////////////
+static std::string locKey(const SourceManager &SourceManager, SourceLocation loc) {
+  loc = SourceManager.getSpellingLoc(loc);
+  return SourceManager.getFilename(loc).str() + ":" +
+         std::to_string(SourceManager.getSpellingLineNumber(loc)) + ":" +
+         std::to_string(SourceManager.getSpellingColumnNumber(loc));
+}
+
+static std::string declKey(const SourceManager &SourceManager, const Decl *decl) {
+  return locKey(SourceManager, decl->getLocation());
+}
+
+static bool isDerivedFromName(const CXXRecordDecl *decl, StringRef name) {
+  if (decl==nullptr) {
+    return false;
+  }
+  if (decl->getName() == name) return true;
+  if (!decl->hasDefinition()) return false; // this is needed so bases_begin doesn't crash
+  for (auto it = decl->bases_begin(); it != decl->bases_end(); ++it) {
+    if (isDerivedFromName(it->getType()->getAsCXXRecordDecl(), name)) return true;
+  }
+  return false;
+}
+
+static int isOwningAlias(const std::string &key, std::unordered_set<std::string> &seen, bool &mixed);
+
+// 1 when the list of 'key' owns its elements, 0 when not, -1 when it is
+// being looked at already further up
+static int isOwningKey(const std::string &key, std::unordered_set<std::string> &seen, bool &mixed) {
+  if (g_owning_decl.count(key)) return g_not_owning_decl.count(key) ? 0 : 1;
+  if (!seen.insert(key).second) return -1;
+  return isOwningAlias(key, seen, mixed);
+}
+
+// whether the lists 'key' is bound to own their elements, see g_list_alias;
+// mixed tells a pointer that gets both
+static int isOwningAlias(const std::string &key, std::unordered_set<std::string> &seen, bool &mixed) {
+  const auto alias = g_list_alias.find(key);
+  if (alias == g_list_alias.end()) {
+    return 0;
+  }
+  bool owning = false, notOwning = false;
+  for (const auto &source : alias->second) {
+    // a list and the classes it is an instance of, separated by tabs
+    SmallVector<StringRef, 4> keys;
+    StringRef(source).split(keys, '\t');
+    int owns = -1;
+    for (auto k : keys) owns = std::max(owns, isOwningKey(k.str(), seen, mixed));
+    if (owns == 1) owning = true;
+    if (owns == 0) notOwning = true;
+  }
+  mixed = mixed || (owning && notOwning);
+  return owning ? 1 : (notOwning ? 0 : -1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// True for a list whose elements become std::unique_ptr: a variable or field
+// that gets setAutoDelete(TRUE) and never FALSE, or one whose class inherits
+// QList and calls it on itself (ArgumentList), so `ArgumentList *al` owns
+// through its class. A pointer or reference follows the lists it is bound
+// to, see CollectAliasCb.
+////////////////////////////////////////////////////////////////////////////////
+static bool isOwning(const SourceManager &SourceManager, const Decl *decl) {
+  if (decl==nullptr) {
+    return false;
+  }
+  const auto key = declKey(SourceManager, decl);
+  if (g_owning_decl.find(key) != g_owning_decl.end()) return g_not_owning_decl.find(key) == g_not_owning_decl.end();
+  std::unordered_set<std::string> seen = { key };
+  bool mixed = false;
+  const bool owning = isOwningAlias(key, seen, mixed) == 1;
+  if (mixed) {
+    static std::unordered_set<std::string> reported;
+    if (reported.insert(key).second) {
+      llvm::errs() << key << ": bound to owning and non-owning lists, takes std::unique_ptr, check the translation\n";
+    }
+  }
+  if (owning) return true;
+  if (const auto record = dyn_cast<CXXRecordDecl>(decl)) {
+    if (record->getName() == "QList" || !record->hasDefinition()) return false; // this is needed so bases_begin doesn't crash
+    for (auto it = record->bases_begin(); it != record->bases_end(); ++it) {
+      if (isOwning(SourceManager, it->getType()->getAsCXXRecordDecl())) return true;
+    }
+    return false;
+  }
+  if (const auto value = dyn_cast<ValueDecl>(decl)) {
+    auto type = value->getType().getNonReferenceType();
+    if (type->isPointerType()) type = type->getPointeeType();
+    return isOwning(SourceManager, type->getAsCXXRecordDecl());
+  }
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Returns the declaration a container expression refers to:
+//   list / *list / m_list / p->m_list -> VarDecl or FieldDecl
+//   this (class inheriting the container) -> CXXRecordDecl
+////////////////////////////////////////////////////////////////////////////////
+static const Decl *getObjectDecl(const Expr *obj) {
+  if (obj==nullptr) {
+    return nullptr;
+  }
+  obj = obj->IgnoreParenImpCasts();
+  if (auto op = dyn_cast<UnaryOperator>(obj)) {
+    if (op->getOpcode() == UO_Deref) obj = op->getSubExpr()->IgnoreParenImpCasts();
+  }
+  if (auto member = dyn_cast<MemberExpr>(obj)) {
+    return member->getMemberDecl();
+  }
+  if (auto ref = dyn_cast<DeclRefExpr>(obj)) {
+    return ref->getDecl();
+  }
+  if (auto self = dyn_cast<CXXThisExpr>(obj)) {
+    return self->getType()->getPointeeCXXRecordDecl();
+  }
+  return nullptr;
+}
+
+// the list of a member call or iterator, also when it is no named variable: md->argumentList()
+static bool isOwningObject(const SourceManager &SourceManager, const Expr *obj) {
+  if (obj==nullptr) {
+    return false;
+  }
+  if (isOwning(SourceManager, getObjectDecl(obj))) return true;
+  auto type = obj->IgnoreParenImpCasts()->getType();
+  if (type->isPointerType()) type = type->getPointeeType();
+  return isOwning(SourceManager, type->getAsCXXRecordDecl());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Returns the declaration 'e' gets stored into:
+//   m_list = new QList<T>; QList<T> *l = new QList<T>; : m_list(new QList<T>)
+////////////////////////////////////////////////////////////////////////////////
+static const Decl *getAssignedDecl(ASTContext &Context, const Expr *e) {
+  const Expr *child = e;
+  auto parents = Context.getParents(*e);
+  while (!parents.empty()) {
+    if (auto var = parents[0].get<VarDecl>()) {
+      return var;
+    }
+    if (auto op = parents[0].get<BinaryOperator>()) {
+      return op->getOpcode() == BO_Assign ? getObjectDecl(op->getLHS()) : nullptr;
+    }
+    // the parent map has no CXXCtorInitializer, a mem-initializer hangs off its constructor
+    if (auto ctor = parents[0].get<CXXConstructorDecl>()) {
+      for (auto init : ctor->inits()) {
+        if (init->getInit() == child) return init->getMember();
+      }
+      return nullptr;
+    }
+    auto parent = parents[0].get<Expr>();
+    if (parent == nullptr || !(isa<ImplicitCastExpr>(parent) || isa<ParenExpr>(parent) || isa<ExprWithCleanups>(parent))) {
+      return nullptr;
+    }
+    child = parent;
+    parents = Context.getParents(*parent);
+  }
+  return nullptr;
+}
+
+static std::string typeName(QualType type) {
+  PrintingPolicy policy((LangOptions()));
+  policy.SuppressTagKeyword = true;
+  return type.getAsString(policy);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Returns T for QList<T> or for any class inheriting it.
+////////////////////////////////////////////////////////////////////////////////
+static std::string getQListElementType(const CXXRecordDecl *decl) {
+  if (decl==nullptr) {
+    return std::string();
+  }
+  if (auto spec = dyn_cast<ClassTemplateSpecializationDecl>(decl)) {
+    if (spec->getName() == "QList") return typeName(spec->getTemplateArgs()[0].getAsType());
+  }
+  if (!decl->hasDefinition()) return std::string(); // this is needed so bases_begin doesn't crash
+  for (auto it = decl->bases_begin(); it != decl->bases_end(); ++it) {
+    auto str = getQListElementType(it->getType()->getAsCXXRecordDecl());
+    if (!str.empty()) return str;
+  }
+  return std::string();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Collects the references to a variable or field below a statement.
+////////////////////////////////////////////////////////////////////////////////
+class DeclRefCollector : public RecursiveASTVisitor<DeclRefCollector> {
+public:
+    DeclRefCollector(const Decl *decl) : Target(decl) {}
+
+    bool VisitDeclRefExpr(DeclRefExpr *ref) {
+      if (ref->getDecl() == Target) Refs.push_back(ref);
+      return true;
+    }
+    bool VisitMemberExpr(MemberExpr *ref) {
+      if (ref->getMemberDecl() == Target) Refs.push_back(ref);
+      return true;
+    }
+
+    const Decl *Target;
+    std::vector<const Expr*> Refs;
+};
+
+static std::vector<const Expr*> findRefs(const Stmt *stmt, const Decl *decl) {
+  DeclRefCollector collector(decl);
+  if (stmt) collector.TraverseStmt(const_cast<Stmt*>(stmt));
+  return collector.Refs;
+}
+
+static bool contains(const SourceManager &SourceManager, const Stmt *outer, SourceLocation loc) {
+  return outer &&
+    !SourceManager.isBeforeInTranslationUnit(loc, outer->getLocStart()) &&
+    !SourceManager.isBeforeInTranslationUnit(outer->getLocEnd(), loc);
+}
+
+// the innermost loop around 'stmt' in its function
+static const Stmt *getEnclosingLoop(ASTContext &Context, const Stmt *stmt) {
+  auto parents = Context.getParents(*stmt);
+  while (!parents.empty()) {
+    const auto parent = parents[0].get<Stmt>();
+    if (parent==nullptr) {
+      return nullptr;
+    }
+    if (isa<ForStmt>(parent) || isa<WhileStmt>(parent) || isa<DoStmt>(parent) || isa<CXXForRangeStmt>(parent)) return parent;
+    parents = Context.getParents(*parent);
+  }
+  return nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Returns the location right after 'stmt', including the ';' that ends an
+// expression statement.
+////////////////////////////////////////////////////////////////////////////////
+static SourceLocation getStmtEnd(const SourceManager &SourceManager, const Stmt *stmt) {
+  auto last = SourceManager.getSpellingLoc(stmt->getLocEnd());
+  auto semi = Lexer::findLocationAfterToken(last, tok::semi, SourceManager, LangOptions(), false);
+  if (semi.isValid()) return semi;
+  return Lexer::getLocForEndOfToken(last, 0, SourceManager, LangOptions());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Returns the range to remove for 'stmt'. When the statement is alone on its
+// line the indentation and the line break go with it.
+////////////////////////////////////////////////////////////////////////////////
+static CharSourceRange getStmtLineRange(const SourceManager &SourceManager, const Stmt *stmt) {
+  auto begin = SourceManager.getSpellingLoc(stmt->getLocStart());
+  auto end   = getStmtEnd(SourceManager, stmt);
+  bool Invalid = false;
+  auto buffer = SourceManager.getBufferData(SourceManager.getFileID(begin), &Invalid);
+  if (Invalid) {
+    return CharSourceRange::getCharRange(begin, end);
+  }
+  unsigned b = SourceManager.getFileOffset(begin);
+  unsigned e = SourceManager.getFileOffset(end);
+  unsigned lb = b, le = e;
+  while (lb > 0 && (buffer[lb-1]==' ' || buffer[lb-1]=='\t')) --lb;
+  while (le < buffer.size() && (buffer[le]==' ' || buffer[le]=='\t')) ++le;
+  if ((lb==0 || buffer[lb-1]=='\n') && le < buffer.size() && buffer[le]=='\n') {
+    return CharSourceRange::getCharRange(begin.getLocWithOffset(lb-b), end.getLocWithOffset(le+1-e));
+  }
+  return CharSourceRange::getCharRange(begin, end);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// True when every reference to local 'var' is inside a loop that becomes a
+// range-based for, so its declaration can go.
+////////////////////////////////////////////////////////////////////////////////
+static bool isConsumedByRangeFor(const SourceManager &SourceManager, const VarDecl *var) {
+  if (!var->isLocalVarDecl()) return false;
+  if (g_range_for_refs.find(declKey(SourceManager, var)) == g_range_for_refs.end()) return false;
+  const auto fn = dyn_cast_or_null<FunctionDecl>(var->getParentFunctionOrMethod());
+  if (fn==nullptr || !fn->hasBody()) {
+    return false;
+  }
+  auto refs = findRefs(fn->getBody(), var);
+  if (refs.empty()) return false;
+  for (auto ref : refs) {
+    if (g_range_for_refs.find(locKey(SourceManager, ref->getExprLoc())) == g_range_for_refs.end()) return false;
+  }
+  return true;
+}
+
 class BaseMatcherCb : public ast_matchers::MatchFinder::MatchCallback {
 public:
     BaseMatcherCb(tooling::Replacements *r) : Replace(r) {}
@@ -118,6 +432,354 @@ public:
 };
 
 
+////////////////////////////////////////////////////////////////////////////////
+// Container usage measured by shim/qprofile.h, see -profile.
+// The shim tags every container with the file:line its constructor was
+// called from: the declaration of a variable, a new expression, or the
+// constructor of the class that holds the container or inherits it.
+////////////////////////////////////////////////////////////////////////////////
+struct ProfileSite {
+  long instances = 0;
+  long inserts = 0;
+  long removes = 0;
+  long lookups = 0;
+  long iterations = 0;
+  long clears = 0;
+  long peak = 0;
+
+  void add(const ProfileSite &site) {
+    instances  += site.instances;
+    inserts    += site.inserts;
+    removes    += site.removes;
+    lookups    += site.lookups;
+    iterations += site.iterations;
+    clears     += site.clears;
+    peak        = std::max(peak, site.peak);
+  }
+};
+
+// "file:line\tQList\tT" -> usage, file without directory so that a profile
+// of another checkout applies
+std::map<std::string, ProfileSite> g_profile;
+// declKey of a container pointer -> file:line of the new expressions stored into it
+std::map<std::string, std::vector<std::string>> g_new_sites;
+
+static std::string siteKey(const std::string &file, unsigned line) {
+  return llvm::sys::path::filename(file).str() + ":" + std::to_string(line);
+}
+
+static bool loadProfile(const std::string &path) {
+  auto buffer = llvm::MemoryBuffer::getFile(path);
+  if (!buffer) {
+    llvm::errs() << path << ": " << buffer.getError().message() << "\n";
+    return false;
+  }
+  SmallVector<StringRef, 256> lines;
+  (*buffer)->getBuffer().split(lines, '\n', -1, false);
+  for (size_t i = 1; i < lines.size(); ++i) { // the first line names the columns
+    SmallVector<StringRef, 12> cols;
+    lines[i].split(cols, '\t');
+    if (cols.size() < 10) continue;
+    const auto colon = cols[0].rfind(':');
+    unsigned line = 0;
+    if (colon == StringRef::npos || cols[0].substr(colon+1).getAsInteger(10, line)) continue;
+    ProfileSite site;
+    long *counters[] = { &site.instances, &site.inserts, &site.removes, &site.lookups, &site.iterations, &site.clears, &site.peak };
+    for (size_t c = 0; c < 7; ++c) cols[3+c].getAsInteger(10, *counters[c]);
+    g_profile[siteKey(cols[0].substr(0, colon), line) + "\t" + cols[1].str() + "\t" + cols[2].str()].add(site);
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Returns the qtools container 'record' is or inherits, with its element type.
+////////////////////////////////////////////////////////////////////////////////
+static const ClassTemplateSpecializationDecl *getProfiledContainer(const CXXRecordDecl *record) {
+  if (record==nullptr) {
+    return nullptr;
+  }
+  if (auto spec = dyn_cast<ClassTemplateSpecializationDecl>(record)) {
+    const auto name = spec->getName();
+    if (name == "QList" || name == "QDict" || name == "QIntDict" || name == "QCache" || name == "SDict") return spec;
+  }
+  if (!record->hasDefinition()) return nullptr; // this is needed so bases_begin doesn't crash
+  for (auto it = record->bases_begin(); it != record->bases_end(); ++it) {
+    if (auto spec = getProfiledContainer(it->getType()->getAsCXXRecordDecl())) return spec;
+  }
+  return nullptr;
+}
+
+// the lines from the constructor name to its body, where its member and base
+// initializers run
+static void addConstructorSites(const SourceManager &SourceManager, const CXXRecordDecl *record, std::vector<std::string> &sites) {
+  const auto loc = SourceManager.getSpellingLoc(record->getLocation());
+  sites.push_back(siteKey(SourceManager.getFilename(loc), SourceManager.getSpellingLineNumber(loc)));
+  for (auto ctor : record->ctors()) {
+    for (auto redecl : ctor->redecls()) {
+      const auto begin = SourceManager.getSpellingLoc(redecl->getLocation());
+      const auto body = redecl->getBody() ? SourceManager.getSpellingLoc(redecl->getBody()->getLocStart()) : begin;
+      const auto file = SourceManager.getFilename(begin);
+      for (auto line = SourceManager.getSpellingLineNumber(begin); line <= SourceManager.getSpellingLineNumber(body); ++line) {
+        sites.push_back(siteKey(file, line));
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Sums the profile of every container 'decl' stands for: a variable, a field,
+// a pointer to a container or a class inheriting one. Returns false without
+// a profile, and for a field the profile cannot tell from another field of
+// the same type.
+////////////////////////////////////////////////////////////////////////////////
+static bool getProfile(const SourceManager &SourceManager, const Decl *decl, ProfileSite &profile) {
+  if (g_profile.empty() || decl==nullptr) {
+    return false;
+  }
+  const CXXRecordDecl *record = nullptr;
+  bool pointer = false;
+  if (auto value = dyn_cast<ValueDecl>(decl)) {
+    auto type = value->getType().getNonReferenceType();
+    pointer = type->isPointerType();
+    record = pointer ? type->getPointeeCXXRecordDecl() : type->getAsCXXRecordDecl();
+  } else {
+    record = dyn_cast<CXXRecordDecl>(decl);
+  }
+  const auto spec = getProfiledContainer(record);
+  if (spec==nullptr) {
+    return false;
+  }
+  std::vector<std::string> sites;
+  if (record != spec) {
+    // the default arguments of the container constructor are evaluated in the inheriting class
+    addConstructorSites(SourceManager, record, sites);
+  } else if (pointer) {
+    const auto it = g_new_sites.find(declKey(SourceManager, decl));
+    if (it != g_new_sites.end()) sites = it->second;
+  } else if (auto field = dyn_cast<FieldDecl>(decl)) {
+    for (auto other : field->getParent()->fields()) {
+      if (other != field && other->getType().getCanonicalType() == field->getType().getCanonicalType()) return false;
+    }
+    addConstructorSites(SourceManager, cast<CXXRecordDecl>(field->getParent()), sites);
+  } else {
+    const auto loc = SourceManager.getSpellingLoc(decl->getLocation());
+    sites.push_back(siteKey(SourceManager.getFilename(loc), SourceManager.getSpellingLineNumber(loc)));
+  }
+  std::sort(sites.begin(), sites.end());
+  sites.erase(std::unique(sites.begin(), sites.end()), sites.end());
+
+  const auto suffix = "\t" + spec->getName().str() + "\t" + typeName(spec->getTemplateArgs()[0].getAsType());
+  bool found = false;
+  for (const auto &site : sites) {
+    const auto it = g_profile.find(site + suffix);
+    if (it != g_profile.end()) {
+      profile.add(it->second);
+      found = true;
+    }
+  }
+  return found;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Prints the measured usage next to the translation chosen for 'decl', once.
+////////////////////////////////////////////////////////////////////////////////
+static void reportProfile(const SourceManager &SourceManager, const Decl *decl, const std::string &target) {
+  static std::unordered_set<std::string> reported;
+  ProfileSite profile;
+  if (!getProfile(SourceManager, decl, profile) || !reported.insert(declKey(SourceManager, decl)).second) {
+    return;
+  }
+  llvm::errs() << declKey(SourceManager, decl) << ": -> " << target
+               << " instances " << profile.instances << " peak " << profile.peak
+               << " inserts " << profile.inserts << " removes " << profile.removes
+               << " lookups " << profile.lookups << " iterations " << profile.iterations << "\n";
+}
+
+// match: p = new QList<T>; remembers the site of a container pointer for getProfile()
+class CollectNewSiteCb : public ast_matchers::MatchFinder::MatchCallback {
+public:
+    virtual void run(const ast_matchers::MatchFinder::MatchResult &result) {
+      const auto expr = result.Nodes.getNodeAs<CXXNewExpr>("profiledNew");
+      if (expr==nullptr) {
+        return;
+      }
+      const auto decl = getAssignedDecl(*result.Context, expr);
+      if (decl==nullptr) {
+        return;
+      }
+      const auto &sm = *result.SourceManager;
+      const auto loc = sm.getSpellingLoc(expr->getLocStart());
+      g_new_sites[declKey(sm, decl)].push_back(siteKey(sm.getFilename(loc), sm.getSpellingLineNumber(loc)));
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Map backends, see -dict-backend, -intdict-backend, -backend-sites and
+// -flat-lookup-ratio. A declaration listed in the sites file gets the backend
+// given there, then a profiled one that is mostly looked up gets the flat
+// map, any other the backend of its rule.
+////////////////////////////////////////////////////////////////////////////////
+// file:line (file without directory, see siteKey) -> backend
+std::map<std::string, MapBackend> g_backend_sites;
+// file:line of the declarations whose std::list/std::unordered_map become
+// std::pmr ones on qstl::arena() (qstl/arena.h)
+std::unordered_set<std::string> g_pmr_sites;
+// fields (see declKey) a constructor initializes itself: m_dict(257)
+std::unordered_set<std::string> g_ctor_init_fields;
+
+static bool loadBackendSites(const std::string &path) {
+  auto buffer = llvm::MemoryBuffer::getFile(path);
+  if (!buffer) {
+    llvm::errs() << path << ": " << buffer.getError().message() << "\n";
+    return false;
+  }
+  SmallVector<StringRef, 64> lines;
+  (*buffer)->getBuffer().split(lines, '\n', -1, false);
+  for (auto line : lines) {
+    line = line.split('#').first.trim();
+    if (line.empty()) continue;
+    SmallVector<StringRef, 4> fields;
+    line.split(fields, ' ', -1, false);
+    const auto colon = fields[0].rfind(':');
+    unsigned number = 0;
+    if (fields.size() < 2 || colon == StringRef::npos || fields[0].substr(colon+1).getAsInteger(10, number)) {
+      llvm::errs() << path << ": expected 'file:line std|flat|pmr...', got '" << line << "'\n";
+      return false;
+    }
+    const auto site = siteKey(fields[0].substr(0, colon), number);
+    for (size_t i = 1; i < fields.size(); ++i) {
+      if (fields[i] == "std" || fields[i] == "flat") {
+        g_backend_sites[site] = fields[i] == "flat" ? FlatMap : StdMap;
+      } else if (fields[i] == "pmr") {
+        g_pmr_sites.insert(site);
+      } else {
+        llvm::errs() << path << ": unknown '" << fields[i] << "' in '" << line << "'\n";
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// the std|flat entry of -backend-sites for 'decl', or nullptr
+static const MapBackend *getBackendSite(const SourceManager &SourceManager, const Decl *decl) {
+  if (g_backend_sites.empty() || decl==nullptr) {
+    return nullptr;
+  }
+  const auto loc = SourceManager.getSpellingLoc(decl->getLocation());
+  const auto site = g_backend_sites.find(siteKey(SourceManager.getFilename(loc), SourceManager.getSpellingLineNumber(loc)));
+  return site != g_backend_sites.end() ? &site->second : nullptr;
+}
+
+static MapBackend getBackend(const SourceManager &SourceManager, const Decl *decl, MapBackend backend) {
+  if (decl==nullptr) {
+    return backend;
+  }
+  if (const auto site = getBackendSite(SourceManager, decl)) {
+    return *site;
+  }
+  ProfileSite profile;
+  if (FlatLookupRatio > 0 && getProfile(SourceManager, decl, profile) &&
+      profile.lookups >= FlatLookupRatio * std::max(1L, profile.inserts)) {
+    return FlatMap;
+  }
+  return backend;
+}
+
+// match: the constructors, remembers the fields they initialize, see isPmr()
+class CollectCtorInitCb : public ast_matchers::MatchFinder::MatchCallback {
+public:
+    virtual void run(const ast_matchers::MatchFinder::MatchResult &result) {
+      const auto ctor = result.Nodes.getNodeAs<CXXConstructorDecl>("ctorInit");
+      if (ctor==nullptr) {
+        return;
+      }
+      for (auto init : ctor->inits()) {
+        if (init->isWritten() && init->getMember()) {
+          g_ctor_init_fields.insert(declKey(*result.SourceManager, init->getMember()));
+        }
+      }
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// A field or global marked pmr in -backend-sites. Not a local or parameter:
+// the arena never frees, every call of the function would leave its nodes
+// behind. Not a container field a constructor initializes itself: its
+// mem-initializer, m_dict(257), would override the {qstl::arena()} of the
+// declaration and take the default resource. A pointer field initialized
+// with new gets the arena in there.
+////////////////////////////////////////////////////////////////////////////////
+static bool isPmr(const SourceManager &SourceManager, const Decl *decl) {
+  if (g_pmr_sites.empty() || decl==nullptr || !isa<DeclaratorDecl>(decl)) {
+    return false;
+  }
+  const auto loc = SourceManager.getSpellingLoc(decl->getLocation());
+  if (!g_pmr_sites.count(siteKey(SourceManager.getFilename(loc), SourceManager.getSpellingLineNumber(loc)))) {
+    return false;
+  }
+  const auto key = declKey(SourceManager, decl);
+  if (isa<VarDecl>(decl) && cast<VarDecl>(decl)->hasLocalStorage()) {
+    static std::unordered_set<std::string> reported;
+    if (reported.insert(key).second) {
+      llvm::errs() << key << ": pmr ignored, the arena would keep the nodes of a local after every call\n";
+    }
+    return false;
+  }
+  if (isa<FieldDecl>(decl) && !cast<FieldDecl>(decl)->getType()->isPointerType() && g_ctor_init_fields.count(key)) {
+    static std::unordered_set<std::string> reported;
+    if (reported.insert(key).second) {
+      llvm::errs() << key << ": pmr ignored, a constructor initializes the field itself\n";
+    }
+    return false;
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Returns the initializer that puts a pmr container declared by 'decl' on
+// the arena: QList<T> m_list; -> std::pmr::list<T*> m_list{qstl::arena()};
+// Empty for a pointer, whose new expression gets the arena, and for a
+// declaration that is initialized already.
+////////////////////////////////////////////////////////////////////////////////
+static std::string arenaInit(const DeclaratorDecl *decl) {
+  if (decl->getType()->isPointerType()) {
+    return std::string();
+  }
+  if (auto field = dyn_cast<FieldDecl>(decl)) {
+    return field->hasInClassInitializer() ? std::string() : "{qstl::arena()}";
+  }
+  auto var = dyn_cast<VarDecl>(decl);
+  const auto init = var && var->getInit() ? dyn_cast<CXXConstructExpr>(var->getInit()->IgnoreImplicit()) : nullptr;
+  if (var==nullptr || isa<ParmVarDecl>(var) || (var->getInit() && (init==nullptr || init->getNumArgs() > 0))) {
+    return std::string();
+  }
+  return "{qstl::arena()}";
+}
+
+// format for the replacement of Q(Int)Dict<(\w+)> in 'decl', whose rule defaults to 'backend';
+// the flat map is one array already, pmr only applies to std::unordered_map
+static std::string mapType(const SourceManager &SourceManager, const Decl *decl, MapBackend backend, const std::string &key) {
+  std::string type;
+  if (getBackend(SourceManager, decl, backend) == FlatMap) {
+    type = "qstl::flat_hash_map<" + key + ", $1*>";
+  } else {
+    type = (isPmr(SourceManager, decl) ? "std::pmr::unordered_map<" : "std::unordered_map<") + key + ", $1*>";
+  }
+  if (decl) reportProfile(SourceManager, decl, type);
+  return type;
+}
+
+// the container an iterator is constructed on: QDictIterator<T> it(*dict)
+static const Expr *getIteratedObject(const VarDecl *var) {
+  const auto init = var->getInit() ? dyn_cast<CXXConstructExpr>(var->getInit()->IgnoreImplicit()) : nullptr;
+  return init && init->getNumArgs() > 0 ? init->getArg(0) : nullptr;
+}
+
+static const Decl *getIteratedDecl(const VarDecl *var) {
+  return getObjectDecl(getIteratedObject(var));
+}
+
 namespace qdict {
 // O:- [ ] QDict <T> -> std::unordered_map<std::string, T*>
 // O:  - [x] variable declaration QDictIterator
@@ -132,20 +794,23 @@ public:
         llvm::errs() <<"Unable to get decl\n";
         return;
       }
+      if (isConsumedByRangeFor(*result.SourceManager, decl)) return; // removed by RangeForDeclCb
       auto str = getText(*result.SourceManager,*decl);
-      if (! findNreplace(str,"QDictIterator\\s*<\\s*(\\w+)\\s*>\\s*(\\w+)\\(\\*(.*)\\)","std::unordered_map<std::string, $1*>::iterator $2(@B$3->@Ebegin())") )
-      if (! findNreplace(str,"QDictIterator\\s*<\\s*(\\w+)\\s*>\\s*(\\w+)\\((.*)\\)","std::unordered_map<std::string, $1*>::iterator $2(@B$3.@Ebegin())") )
-      if (! findNreplace(str,"QDictIterator\\s*<\\s*(\\w+)\\s*>\\s*\\((.*)\\)","std::unordered_map<std::string, $1*>::iterator ($2->begin())") )
-      if (! findNreplace(str,"QDictIterator\\s*<\\s*(\\w+)\\s*>","std::unordered_map<std::string, $1*>::iterator") )
-      if (! findNreplace(str,"(\\w+)DictIterator (\\w+)\\(\\*(.*)\\)","std::unordered_map<std::string, $1*>::iterator $2(@B$3->@Ebegin())") )
-      if (! findNreplace(str,"(\\w+)DictIterator (\\w+)\\((.*)\\)","std::unordered_map<std::string, $1*>::iterator $2(@B$3.@Ebegin())") )
-      if (! findNreplace(str,"(\\w+)DictIterator","std::unordered_map<std::string, $1*>::iterator") )
+      // the iterator type follows the backend of the dictionary it walks
+      auto map = mapType(*result.SourceManager, getIteratedDecl(decl), DictBackend, "std::string");
+      if (! findNreplace(str,"QDictIterator\\s*<\\s*(\\w+)\\s*>\\s*(\\w+)\\(\\*(.*)\\)",map + "::iterator $2(@B$3->@Ebegin())") )
+      if (! findNreplace(str,"QDictIterator\\s*<\\s*(\\w+)\\s*>\\s*(\\w+)\\((.*)\\)",map + "::iterator $2(@B$3.@Ebegin())") )
+      if (! findNreplace(str,"QDictIterator\\s*<\\s*(\\w+)\\s*>\\s*\\((.*)\\)",map + "::iterator ($2->begin())") )
+      if (! findNreplace(str,"QDictIterator\\s*<\\s*(\\w+)\\s*>",map + "::iterator") )
+      if (! findNreplace(str,"(\\w+)DictIterator (\\w+)\\(\\*(.*)\\)",map + "::iterator $2(@B$3->@Ebegin())") )
+      if (! findNreplace(str,"(\\w+)DictIterator (\\w+)\\((.*)\\)",map + "::iterator $2(@B$3.@Ebegin())") )
+      if (! findNreplace(str,"(\\w+)DictIterator",map + "::iterator") )
         return;
       Replace->insert(Replacement(*result.SourceManager, decl, str));
     }
 };
 
-// O:  - [x] field declaration QList
+// O:  - [x] field declaration QDict -> std::unordered_map<std::string, T*>, qstl::flat_hash_map<std::string, T*>
 class FieldDeclCb : public BaseMatcherCb {
 public:
     FieldDeclCb(tooling::Replacements *r) : BaseMatcherCb(r) {}
@@ -157,7 +822,8 @@ public:
         return;
       }
       auto str = getText(*result.SourceManager,*decl);
-      if (! findNreplace(str,"QDict<(\\w+)>","std::unordered_map<std::string, $1*>") ) return;
+      if (! findNreplace(str,"QDict<(\\w+)>",mapType(*result.SourceManager, decl, DictBackend, "std::string")) ) return;
+      if (str.find("std::pmr::") != std::string::npos) str += arenaInit(decl);
       Replacement rep(*result.SourceManager, decl, str);
       if (g_unique_fdecl.find(decl) == g_unique_fdecl.end()) {
         Replace->insert(rep);
@@ -170,6 +836,16 @@ public:
 
 namespace qlist {
 
+// format for the replacement of QList<(\w+)>: an auto-deleting list owns its
+// elements, so they become std::unique_ptr (std::shared_ptr would add an
+// atomic refcount to every copy of an element)
+static std::string listType(const SourceManager &SourceManager, const Decl *decl) {
+  std::string type = isOwning(SourceManager, decl) ? "list<std::unique_ptr<$1>>" : "list<$1*>";
+  type = (isPmr(SourceManager, decl) ? "std::pmr::" : "std::") + type;
+  reportProfile(SourceManager, decl, type);
+  return type;
+}
+
 // O:- [ ] QList <T> -> std::list<T*>
 // O:  - [x] class inheriting QList
 class InheritCb : public BaseMatcherCb {
@@ -185,7 +861,7 @@ public:
       auto it = decl->bases_begin();
       for (; it && it != decl->bases_end(); ++it) {
         auto str = getText(*result.SourceManager,it->getLocStart(),it->getLocEnd()) ;
-        if (! findNreplace(str,"QList<(\\w+)>","std::list<$1*>") ) return;
+        if (! findNreplace(str,"QList<(\\w+)>",listType(*result.SourceManager,decl)) ) return;
         Replace->insert(Replacement(*result.SourceManager, it, str));
       }
     }
@@ -203,7 +879,8 @@ public:
         return;
       }
       auto str = getText(*result.SourceManager,*decl);
-      if (! findNreplace(str,"QList<(\\w+)>","std::list<$1*>") ) return;
+      if (! findNreplace(str,"QList<(\\w+)>",listType(*result.SourceManager,decl)) ) return;
+      if (isPmr(*result.SourceManager, decl)) str += arenaInit(decl);
       Replace->insert(Replacement(*result.SourceManager, decl, str));
     }
 };
@@ -220,7 +897,8 @@ public:
         return;
       }
       auto str = getText(*result.SourceManager,*decl);
-      if (! findNreplace(str,"QList<(\\w+)>","std::list<$1*>") ) return;
+      if (! findNreplace(str,"QList<(\\w+)>",listType(*result.SourceManager,decl)) ) return;
+      if (isPmr(*result.SourceManager, decl)) str += arenaInit(decl);
       Replacement rep(*result.SourceManager, decl, str);
       if (g_unique_fdecl.find(decl) == g_unique_fdecl.end()) {
         Replace->insert(rep);
@@ -258,6 +936,13 @@ public:
         llvm::errs() << "unable to get " << m << "\n";
         return;
       }
+      if (isOwningObject(*result.SourceManager, call->getImplicitObjectArgument())) {
+        // the list owns the element, the caller only gets to look at it
+        auto str = getText(*result.SourceManager,*call);
+        if (! findNreplace(str,m+"\\(\\)","front().get()") ) return;
+        Replace->insert(Replacement(*result.SourceManager, call, str));
+        return;
+      }
       const auto callee = call->getCallee();
       auto str = getText(*result.SourceManager,*callee);
       if (! findNreplace(str,m,"front") ) return;
@@ -277,6 +962,13 @@ public:
         llvm::errs() << "unable to get " << m << "\n";
         return;
       }
+      if (isOwningObject(*result.SourceManager, call->getImplicitObjectArgument())) {
+        // the list owns the element, the caller only gets to look at it
+        auto str = getText(*result.SourceManager,*call);
+        if (! findNreplace(str,m+"\\(\\)","back().get()") ) return;
+        Replace->insert(Replacement(*result.SourceManager, call, str));
+        return;
+      }
       const auto callee = call->getCallee();
       auto str = getText(*result.SourceManager,*callee);
       if (! findNreplace(str,m,"back") ) return;
@@ -322,59 +1014,212 @@ public:
     }
 };
 
-class FieldSetAutoDeleteTrueCb : public BaseMatcherCb {
-public:
-    FieldSetAutoDeleteTrueCb(tooling::Replacements *r) : BaseMatcherCb(r) {}
+// setAutoDelete() on a list whose type depends on a template parameter is
+// not resolved to a CXXMemberCallExpr, its callee stays dependent
+static const CXXDependentScopeMemberExpr *dependentCallee(const CallExpr *call, StringRef name) {
+  auto callee = dyn_cast_or_null<CXXDependentScopeMemberExpr>(call->getCallee());
+  if (callee==nullptr || callee->isImplicitAccess()) {
+    return nullptr;
+  }
+  if (callee->getMember().getAsString() != name) return nullptr;
+  if (typeName(callee->getBaseType()).find("QList<") == std::string::npos) return nullptr;
+  return callee;
+}
+
+// list.setAutoDelete(arg) bound to 'id', or to 'id'+"Dependent" when the
+// list type depends on a template parameter
+static const CallExpr *getAutoDeleteCall(const ast_matchers::MatchFinder::MatchResult &result, const std::string &id,
+                                         const Expr *&object, const Expr *&arg) {
+  const CallExpr *call = nullptr;
+  if (const auto member = result.Nodes.getNodeAs<CXXMemberCallExpr>(id)) {
+    call = member;
+    object = member->getImplicitObjectArgument();
+  } else if ((call = result.Nodes.getNodeAs<CallExpr>(id + "Dependent"))) {
+    const auto callee = dependentCallee(call, "setAutoDelete");
+    object = callee ? callee->getBase() : nullptr;
+  }
+  if (call==nullptr || object==nullptr || call->getNumArgs()==0) {
+    return nullptr;
+  }
+  arg = call->getArg(0);
+  return call;
+}
 
+// 1 for TRUE, 0 for FALSE, -1 for anything computed
+static int getAutoDeleteValue(const SourceManager &SourceManager, const Expr *arg) {
+  const auto str = getText(SourceManager, *arg);
+  if (str == "TRUE" || str == "true") return 1;
+  if (str == "FALSE" || str == "false") return 0;
+  return -1;
+}
+
+// O:  - [x] QList->setAutoDelete(TRUE) -> unique_ptr
+// O:    - [x] BUG: setAutoDelete called in template classes is not matched
+// O:    - [x] lists that also get setAutoDelete(FALSE) or a computed argument keep raw pointers
+// O:    - [x] pointers and references bound to a list (initializer, assignment, argument) take its element type
+// Runs before any replacement is made: a list declaration can only be
+// rewritten once we know whether some setAutoDelete(TRUE) makes it own its
+// elements, and that call usually lives in another file (the constructor).
+// One setAutoDelete(FALSE) or setAutoDelete(flag) on the same list means it
+// does not own them all of the time, it keeps raw pointers.
+class CollectAutoDeleteCb : public ast_matchers::MatchFinder::MatchCallback {
+public:
     virtual void run(const ast_matchers::MatchFinder::MatchResult &result) {
-      const auto call = result.Nodes.getNodeAs<CXXConstructorDecl>("Field_setAutoDeleteTRUE");
-      if (call==nullptr) {
+      const Expr *object = nullptr;
+      const Expr *arg = nullptr;
+      if (!getAutoDeleteCall(result, "setAutoDelete", object, arg)) {
         return;
       }
-      const auto fdecl = result.Nodes.getNodeAs<FieldDecl>("C");
-      if (fdecl==nullptr) {
+      const auto value = getAutoDeleteValue(*result.SourceManager, arg);
+      const auto decl = getObjectDecl(object);
+      if (decl==nullptr) {
+        if (value == 1) llvm::errs() << "setAutoDelete(TRUE) on unknown list: " << getText(*result.SourceManager,*object) << "\n";
         return;
       }
-      auto callStr = getText(*result.SourceManager,*call);
-      if (callStr.find("setAutoDelete(TRUE)") == std::string::npos) {
-        return;
+      if (value == 1) {
+        g_owning_decl.insert(declKey(*result.SourceManager, decl));
+      } else {
+        g_not_owning_decl.insert(declKey(*result.SourceManager, decl));
       }
-      if (g_unique_fdecl.find(fdecl) != g_unique_fdecl.end()) {
-        return;
+    }
+};
+
+// the list a pointer or reference type points at, nullptr for a list value or anything else
+static const CXXRecordDecl *getAliasedList(QualType type) {
+  if (!type->isPointerType() && !type->isReferenceType()) {
+    return nullptr;
+  }
+  const auto record = type->getPointeeType()->getAsCXXRecordDecl();
+  return isDerivedFromName(record, "QList") ? record : nullptr;
+}
+
+// a class inheriting QList and its bases, tab separated, see isOwningAlias()
+static void addRecordKeys(const SourceManager &SourceManager, const CXXRecordDecl *record, std::string &source) {
+  if (record==nullptr || record->getName() == "QList" || !record->hasDefinition()) {
+    return;
+  }
+  source += (source.empty() ? "" : "\t") + declKey(SourceManager, record);
+  for (auto it = record->bases_begin(); it != record->bases_end(); ++it) {
+    addRecordKeys(SourceManager, it->getType()->getAsCXXRecordDecl(), source);
+  }
+}
+
+static const Expr *ignoreAddrOf(const Expr *e) {
+  e = e->IgnoreParenImpCasts();
+  const auto op = dyn_cast<UnaryOperator>(e);
+  return op && op->getOpcode() == UO_AddrOf ? op->getSubExpr() : e;
+}
+
+// a pointer or reference 'target' gets bound to the list 'e': QList<T> *l = m_list;
+static void bindAlias(const SourceManager &SourceManager, const Decl *target, const Expr *e) {
+  const auto value = dyn_cast_or_null<ValueDecl>(target);
+  if (value==nullptr || e==nullptr || getAliasedList(value->getType())==nullptr) {
+    return;
+  }
+  e = ignoreAddrOf(e);
+  const auto decl = getObjectDecl(e);
+  std::string source;
+  auto record = dyn_cast_or_null<CXXRecordDecl>(decl);
+  if (decl && record==nullptr) {
+    source = declKey(SourceManager, decl);
+    auto type = e->getType();
+    if (type->isPointerType()) type = type->getPointeeType();
+    record = type->getAsCXXRecordDecl();
+  }
+  addRecordKeys(SourceManager, record, source);
+  if (source.empty()) {
+    return;
+  }
+  const auto key = declKey(SourceManager, value);
+  auto &sources = g_list_alias[key];
+  if (std::find(sources.begin(), sources.end(), source) == sources.end()) sources.push_back(source);
+  // a local list handed on takes the type of where it goes: l = new QList<T>; ... m_list = l;
+  const auto local = dyn_cast_or_null<VarDecl>(decl);
+  if (local && local->isLocalVarDecl() && !local->isStaticLocal()) {
+    auto &back = g_list_alias[declKey(SourceManager, local)];
+    if (std::find(back.begin(), back.end(), key) == back.end()) back.push_back(key);
+  }
+}
+
+// the calls of the qtools lists and iterators themselves, their parameters keep their types
+static bool isQtoolsMethod(const FunctionDecl *fn) {
+  const auto method = dyn_cast_or_null<CXXMethodDecl>(fn);
+  return method && (isDerivedFromName(method->getParent(), "QGList") || isDerivedFromName(method->getParent(), "QGListIterator"));
+}
+
+// the arguments of a call or construction bound to the parameters of every declaration of 'fn'
+static void bindArguments(const SourceManager &SourceManager, const FunctionDecl *fn, const Expr *const *args, unsigned count) {
+  if (fn==nullptr || isQtoolsMethod(fn)) {
+    return;
+  }
+  for (auto redecl : fn->redecls()) {
+    for (unsigned i=0; i<count && i<redecl->getNumParams(); i++) {
+      bindAlias(SourceManager, redecl->getParamDecl(i), args[i]);
+    }
+  }
+}
+
+// match: QList<T> *l = x; l = x; f(x); : m_list(x)
+// Runs before any replacement is made: a pointer or reference to a list
+// has to take the element type of the list it points at, std::unique_ptr
+// or raw pointer, see isOwning().
+class CollectAliasCb : public ast_matchers::MatchFinder::MatchCallback {
+public:
+    virtual void run(const ast_matchers::MatchFinder::MatchResult &result) {
+      const auto &sm = *result.SourceManager;
+      if (const auto var = result.Nodes.getNodeAs<VarDecl>("aliasVar")) {
+        bindAlias(sm, var, var->getInit());
+      } else if (const auto op = result.Nodes.getNodeAs<BinaryOperator>("aliasAssign")) {
+        bindAlias(sm, getObjectDecl(op->getLHS()), op->getRHS());
+      } else if (const auto call = result.Nodes.getNodeAs<CallExpr>("aliasCall")) {
+        // the object of an operator method is its first argument
+        const unsigned skip = isa<CXXOperatorCallExpr>(call) && dyn_cast_or_null<CXXMethodDecl>(call->getDirectCallee()) ? 1 : 0;
+        if (call->getNumArgs() > skip) bindArguments(sm, call->getDirectCallee(), call->getArgs() + skip, call->getNumArgs() - skip);
+      } else if (const auto construct = result.Nodes.getNodeAs<CXXConstructExpr>("aliasConstruct")) {
+        bindArguments(sm, construct->getConstructor(), construct->getArgs(), construct->getNumArgs());
+      } else if (const auto ctor = result.Nodes.getNodeAs<CXXConstructorDecl>("aliasCtor")) {
+        for (auto init : ctor->inits()) {
+          if (init->isWritten() && init->getMember()) bindAlias(sm, init->getMember(), init->getInit());
+        }
       }
-      auto fdeclStr = getText(*result.SourceManager,*fdecl);
-      // place to use shared_ptr
-      if (! findNreplace(fdeclStr,"QList<(\\w+)>","std::list<$1*>") ) return;
-      Replace->insert(Replacement(*result.SourceManager, fdecl, fdeclStr));
-      g_unique_fdecl.insert(fdecl);
     }
 };
 
-// O:  - [ ] QList->setAutoDelete(TRUE) -> unique_ptr
-// O:    - [ ] BUG: setAutoDelete called in template classes is not matched
+// std::list has no setAutoDelete(), ownership moved into the element type.
+// The call goes when the translation does what it asked for: TRUE on a
+// list of std::unique_ptr, FALSE on one of raw pointers. Any other call
+// stays, so the build fails where the elements need a look.
 class SetAutoDeleteTrueCb : public BaseMatcherCb {
 public:
     SetAutoDeleteTrueCb(tooling::Replacements *r) : BaseMatcherCb(r) {}
 
     virtual void run(const ast_matchers::MatchFinder::MatchResult &result) {
-      const auto call = result.Nodes.getNodeAs<CXXMemberCallExpr>("setAutoDeleteTRUE");
+      const Expr *object = nullptr;
+      const Expr *arg = nullptr;
+      const auto call = getAutoDeleteCall(result, "setAutoDeleteTRUE", object, arg);
       if (call==nullptr) {
         return;
       }
-      Replace->insert(Replacement(*result.SourceManager, call, ""));
-
-      const auto thisDecl = result.Nodes.getNodeAs<VarDecl>("thisDecl");
-      if (thisDecl==nullptr) {
+      const auto &sm = *result.SourceManager;
+      const auto value = getAutoDeleteValue(sm, arg);
+      const bool owning = isOwningObject(sm, object);
+      if ((value == 1 && owning) || (value == 0 && !owning)) {
+        Replace->insert(Replacement(sm, call, ""));
         return;
       }
-      auto callStr = getText(*result.SourceManager,*call);
-      auto thisDeclStr = getText(*result.SourceManager,*thisDecl);
-      // place to use shared_ptr
-      if (! findNreplace(thisDeclStr,"QList<(\\w+)>","std::list<$1*>") ) return;
-      Replace->insert(Replacement(*result.SourceManager, thisDecl, thisDeclStr));
+      llvm::errs() << locKey(sm, call->getLocStart()) << ": " << getText(sm, *call) << " on a list of "
+                   << (owning ? "std::unique_ptr" : "raw pointers") << ", not translated\n";
     }
 };
 
+// x -> std::unique_ptr<T>(x), new T(a) -> std::make_unique<T>(a)
+static std::string ownedElement(const SourceManager &SourceManager, const CXXMemberCallExpr *call) {
+  auto str = getText(SourceManager,*call->getArg(0));
+  if (findNreplace(str,"^new\\s+(\\w+)\\s*\\((.*)\\)$","std::make_unique<$1>($2)") ) return str;
+  if (findNreplace(str,"^new\\s+(\\w+)$","std::make_unique<$1>()") ) return str;
+  return "std::unique_ptr<" + getQListElementType(call->getRecordDecl()) + ">(" + str + ")";
+}
+
 // O:    - [x] append(x) -> std::list::push_back(std::make_unique(x))
 class AppendCb : public BaseMatcherCb {
 public:
@@ -389,8 +1234,12 @@ public:
       if (call == nullptr) {
         return;
       }
+      std::string arg = "$1";
+      if (isOwningObject(*result.SourceManager, call->getImplicitObjectArgument())) {
+        arg = ownedElement(*result.SourceManager, call);
+      }
       auto str = getText(*result.SourceManager,*call);
-      if (! findNreplace(str,"append\\((.*)\\)","push_back($1)") ) return;
+      if (! findNreplace(str,"append\\((.*)\\)","push_back(" + arg + ")") ) return;
       Replace->insert(Replacement(*result.SourceManager, call, str));
     }
 };
@@ -409,12 +1258,40 @@ public:
       if (call==nullptr) {
         return;
       }
+      std::string arg = "$1";
+      if (isOwningObject(*result.SourceManager, call->getImplicitObjectArgument())) {
+        arg = ownedElement(*result.SourceManager, call);
+      }
       auto str = getText(*result.SourceManager,*call);
-      if (! findNreplace(str,"prepend\\((.*)\\)","push_front($1)") ) return;
+      if (! findNreplace(str,"prepend\\((.*)\\)","push_front(" + arg + ")") ) return;
       Replace->insert(Replacement(*result.SourceManager, call, str));
     }
 };
 
+// the value of the first return statement in the body of a function
+static const Expr *getReturnValue(const FunctionDecl *fn) {
+  const FunctionDecl *definition = nullptr;
+  const auto body = fn->hasBody(definition) ? dyn_cast_or_null<CompoundStmt>(definition->getBody()) : nullptr;
+  if (body==nullptr) {
+    return nullptr;
+  }
+  for (auto stmt : body->body()) {
+    const auto ret = dyn_cast<ReturnStmt>(stmt);
+    if (ret && ret->getRetValue()) return ret->getRetValue();
+  }
+  return nullptr;
+}
+
+// the container a function hands out: return m_list; return *m_list; return &m_list;
+static const Decl *getReturnedDecl(const FunctionDecl *fn) {
+  const auto value = getReturnValue(fn);
+  if (value==nullptr) {
+    return nullptr;
+  }
+  const auto op = dyn_cast<UnaryOperator>(value->IgnoreParenImpCasts());
+  return getObjectDecl(op && op->getOpcode() == UO_AddrOf ? op->getSubExpr() : value);
+}
+
 // O:  - [ ] return ref: QList<T> & cxxMethodDecl()
 // O:  - [ ] return ptr: QList<T> * cxxMethodDecl()
 // O:  - [ ] return obj: QList<T>   cxxMethodDecl()
@@ -431,12 +1308,14 @@ public:
         return;
       }
       auto str = getText(*result.SourceManager,*fdecl);
-      if (! findNreplace(str,"QList<(\\w+)>","std::list<$1*>") ) return;
+      // the same list type as the container it returns
+      if (! findNreplace(str,"QList<(\\w+)>",listType(*result.SourceManager, getReturnedDecl(fdecl))) ) return;
       Replace->insert(Replacement(*result.SourceManager, fdecl, str));
     }
 };
 
 // O:  - [x] new expression: new QList<T>
+// O:  - [x] fields and globals marked pmr -> std::pmr::list<T*> on qstl::arena()
 class NewExprCb : public BaseMatcherCb {
 public:
     NewExprCb(tooling::Replacements *r) : BaseMatcherCb(r) {}
@@ -447,7 +1326,16 @@ public:
         return;
       }
       auto str = getText(*result.SourceManager,*cxxNewExpr);
-      if (! findNreplace(str,"QList<(\\w+)>","std::list<$1*>") ) return;
+      const auto decl = getAssignedDecl(*result.Context, cxxNewExpr);
+      auto fmt = listType(*result.SourceManager, decl);
+      const auto construct = cxxNewExpr->getConstructExpr();
+      std::string rgx = "QList<(\\w+)>";
+      if (isPmr(*result.SourceManager, decl) && (construct==nullptr || construct->getNumArgs()==0)) {
+        // new QList<T> / new QList<T>() -> new std::pmr::list<T*>(qstl::arena())
+        rgx += "(\\s*\\(\\s*\\))?";
+        fmt += "(qstl::arena())";
+      }
+      if (! findNreplace(str,rgx,fmt) ) return;
       Replace->insert(Replacement(*result.SourceManager, cxxNewExpr, str));
     }
 };
@@ -463,15 +1351,36 @@ public:
         return;
       }
       auto str = getText(*result.SourceManager,*cxxConstructExpr);
-      if ( !findNreplace(str,"QList<(\\w+)>","std::list<$1*>"))
+      const auto decl = getAssignedDecl(*result.Context, cxxConstructExpr);
+      if ( !findNreplace(str,"QList<(\\w+)>",listType(*result.SourceManager, decl)))
         return;
       Replace->insert(Replacement(*result.SourceManager, cxxConstructExpr, str));
     }
 };
 
-// O:  - [ ] remove(item) -> ?
-// O:  - [ ] remove(index) -> ?
-// O:  - [ ] findRef(item) -> ?
+// O:  - [x] remove(item) -> qstl::eraseFirst(list, item)
+// O:  - [x] remove(index) -> qstl::eraseAt(list, index)
+// O:  - [x] findRef(item) -> std::find(), qstl::indexOf(list, item)
+// O:  - [x] remove(item) inside an iterator loop -> remove_if()
+// O:    - [x] other removals from the list an iterator loop walks are left with a warning
+// the rules are RemoveCb, FindRefCb and RemoveIfCb, they come after the
+// iterator loop matching they depend on
+
+// the list a class inheriting QListIterator walks, passed on by its constructor:
+//   ArgumentListIterator(const ArgumentList &l) : QListIterator<Argument>(l) {}
+static const Decl *getIteratorBaseDecl(const CXXRecordDecl *decl) {
+  for (auto ctor : decl->ctors()) {
+    const FunctionDecl *definition = nullptr;
+    const auto body = ctor->hasBody(definition) ? dyn_cast<CXXConstructorDecl>(definition) : nullptr;
+    if (body==nullptr) continue;
+    for (auto init : body->inits()) {
+      if (!init->isBaseInitializer() || init->getInit()==nullptr) continue;
+      const auto construct = dyn_cast<CXXConstructExpr>(init->getInit()->IgnoreImplicit());
+      if (construct && construct->getNumArgs() > 0) return getObjectDecl(construct->getArg(0));
+    }
+  }
+  return nullptr;
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 // O:- [ ] QListIterator <T> -> std::list<T*>::iterator
@@ -486,10 +1395,11 @@ public:
         return;
       }
       if (!decl->hasDefinition()) return; // this is needed so bases_begin doesn't crash
+      const auto type = listType(*result.SourceManager, getIteratorBaseDecl(decl)) + "::iterator";
       auto it = decl->bases_begin();
       for (; it && it != decl->bases_end(); ++it) {
         auto str = getText(*result.SourceManager,it->getLocStart(),it->getLocEnd()) ;
-        if (! findNreplace(str,"QListIterator<(\\w+)>","std::list<$1*>::iterator") ) return;
+        if (! findNreplace(str,"QListIterator<(\\w+)>",type) ) return;
         Replace->insert(Replacement(*result.SourceManager, it, str));
       }
     }
@@ -499,41 +1409,802 @@ public:
 // O:  - [ ] QListIterator<T> li(children) -> std::list<T*>::iterator li = children.begin()
 class VarDeclIteratorCb : public BaseMatcherCb {
 public:
-    VarDeclIteratorCb(tooling::Replacements *r) : BaseMatcherCb(r) {}
+    VarDeclIteratorCb(tooling::Replacements *r) : BaseMatcherCb(r) {}
+
+    virtual void run(const ast_matchers::MatchFinder::MatchResult &result) {
+      const auto decl = result.Nodes.getNodeAs<VarDecl>("varDeclIterator");
+      if (decl==nullptr) {
+        llvm::errs() <<"Unable to get decl\n";
+        return;
+      }
+      if (isConsumedByRangeFor(*result.SourceManager, decl)) return; // removed by RangeForDeclCb
+      auto str = getText(*result.SourceManager,*decl);
+      // the iterator type follows the list it walks
+      auto type = listType(*result.SourceManager, getIteratedDecl(decl)) + "::iterator";
+      if (! findNreplace(str,"QListIterator\\s*<\\s*(\\w+)\\s*>\\s*(\\w+)\\(\\*(.*)\\)",type + " $2(@B$3->@Ebegin())") )
+      if (! findNreplace(str,"QListIterator\\s*<\\s*(\\w+)\\s*>\\s*(\\w+)\\((.*)\\)",type + " $2(@B$3.@Ebegin())") )
+      if (! findNreplace(str,"QListIterator\\s*<\\s*(\\w+)\\s*>\\s*\\((.*)\\)",type + " ($2->begin())") )
+      if (! findNreplace(str,"QListIterator\\s*<\\s*(\\w+)\\s*>",type) )
+      if (! findNreplace(str,"(\\w+)ListIterator (\\w+)\\(\\*(.*)\\)",type + " $2(@B$3->@Ebegin())") )
+      if (! findNreplace(str,"(\\w+)ListIterator (\\w+)\\((.*)\\)",type + " $2(@B$3.@Ebegin())") )
+      if (! findNreplace(str,"(\\w+)ListIterator",type) )
+        return;
+      Replace->insert(Replacement(*result.SourceManager, decl, str));
+    }
+};
+
+class IteratorCb : public BaseMatcherCb {
+public:
+    IteratorCb(tooling::Replacements *r) : BaseMatcherCb(r) {}
+
+    virtual void run(const ast_matchers::MatchFinder::MatchResult &result) {
+      const auto fdecl = result.Nodes.getNodeAs<CXXConstructExpr>("qlistIterator");
+      if (fdecl==nullptr) {
+        return;
+      }
+      const auto var = result.Nodes.getNodeAs<VarDecl>("qlistIteratorVar");
+      if (var && isConsumedByRangeFor(*result.SourceManager, var)) return; // removed by RangeForDeclCb
+      auto str = getText(*result.SourceManager,*fdecl);
+      const auto list = fdecl->getNumArgs() > 0 ? getObjectDecl(fdecl->getArg(0)) : nullptr;
+      auto type = listType(*result.SourceManager, list) + "::iterator";
+      if (! findNreplace(str, "QListIterator<(\\w+)>\\((\\w+)\\)", type + "(@B$2.@Ebegin())") )
+      if (! findNreplace(str,"(\\w+)ListIterator (\\w+)\\((.*)\\)",type + " $2(@B$3.@Ebegin())") )
+        return;
+      Replace->insert(Replacement(*result.SourceManager, fdecl, str));
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// O:  - [x] toFirst()/current() loops -> range-based for
+// The iterator idioms that walk a whole container from the start:
+//   for (li.toFirst(); [cond &&] (a=li.current()); ++li) body
+//   QListIterator<T> li(list); [T *a;] for (; (a=li.current()); ++li) body
+//   while ((a=li.current())) { body; ++li; }
+// become
+//   for (T *a : list) { [if (!cond) break;] body }
+////////////////////////////////////////////////////////////////////////////////
+struct IteratorLoop {
+  const Stmt *loop = nullptr;
+  const Stmt *body = nullptr;
+  const VarDecl *iterator = nullptr;   // li
+  const VarDecl *element = nullptr;    // a
+  const Expr *container = nullptr;     // the container li was constructed on
+  const Expr *exitCond = nullptr;      // cond, evaluated before each element
+  const Stmt *inc = nullptr;           // ++li of a for
+  const Stmt *advance = nullptr;       // ++li at the end of a while body
+  const Expr *removeCond = nullptr;    // cond in 'if (cond) list.remove(a); else ++li;'
+  const CXXMemberCallExpr *removeCall = nullptr; // list.remove(a) of that if
+  const Stmt *rewind = nullptr;        // li.toFirst(); right before the loop
+  bool isDict = false;                 // QDictIterator, elements are key/value pairs
+  std::vector<const CXXMemberCallExpr*> keys; // li.currentKey() in body
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// True when the container an iterator walks ends up with begin() and end():
+//   a class inheriting QList (InheritCb)
+//   a QList variable or field, or a pointer to one (VarDeclCb, FieldDeclCb)
+//   a QDict field, or a pointer to one (qdict::FieldDeclCb)
+// SDict, QIntDict, local QDicts and references to a QList keep their types.
+////////////////////////////////////////////////////////////////////////////////
+static bool isTranslatedContainer(const Expr *container, bool isDict) {
+  const auto record = container->IgnoreParenImpCasts()->getType()->getAsCXXRecordDecl();
+  const StringRef name = isDict ? "QDict" : "QList";
+  if (record==nullptr || !isDerivedFromName(record, name)) {
+    return false;
+  }
+  if (record->getName() != name) return !isDict;
+  const auto decl = dyn_cast_or_null<DeclaratorDecl>(getObjectDecl(container));
+  if (decl==nullptr || !(isa<FieldDecl>(decl) || (!isDict && isa<VarDecl>(decl)))) {
+    return false;
+  }
+  auto type = decl->getType();
+  if (type->isPointerType()) type = type->getPointeeType();
+  const auto declRecord = type->getAsCXXRecordDecl();
+  return declRecord && declRecord->getCanonicalDecl() == record->getCanonicalDecl();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Finds the calls and constructions other rules rewrite: those of a QList
+// or a QStringList. A condition copied out of a range they also replace
+// would keep the Qt calls, and their replacements would overlap the copy.
+////////////////////////////////////////////////////////////////////////////////
+class TranslatedCallFinder : public RecursiveASTVisitor<TranslatedCallFinder> {
+public:
+    bool VisitCallExpr(CallExpr *call) {
+      const CXXRecordDecl *record = nullptr;
+      if (const auto member = dyn_cast<CXXMemberCallExpr>(call)) {
+        record = member->getRecordDecl();
+      } else if (isa<CXXOperatorCallExpr>(call) && call->getNumArgs() && dyn_cast_or_null<CXXMethodDecl>(call->getDirectCallee())) {
+        // l[i], *it: the operator of QValueList<QString> on a QStringList
+        record = call->getArg(0)->IgnoreParenImpCasts()->getType()->getAsCXXRecordDecl();
+      } else if (const auto method = dyn_cast_or_null<CXXMethodDecl>(call->getDirectCallee())) {
+        record = method->getParent();
+      }
+      Found = Found || isTranslated(record);
+      return !Found;
+    }
+    bool VisitCXXConstructExpr(CXXConstructExpr *construct) {
+      Found = Found || isTranslated(construct->getConstructor()->getParent());
+      return !Found;
+    }
+
+    bool Found = false;
+
+private:
+    static bool isTranslated(const CXXRecordDecl *record) {
+      return isDerivedFromName(record, "QList") || isDerivedFromName(record, "QStringList") ||
+             isDerivedFromName(record, "QValueListIterator") || isDerivedFromName(record, "QValueListConstIterator");
+    }
+};
+
+static bool hasTranslatedCall(const Stmt *stmt) {
+  TranslatedCallFinder finder;
+  if (stmt) finder.TraverseStmt(const_cast<Stmt*>(stmt));
+  return finder.Found;
+}
+
+static const VarDecl *getRefVar(const Expr *e) {
+  const auto ref = dyn_cast_or_null<DeclRefExpr>(e ? e->IgnoreParenImpCasts() : nullptr);
+  return ref ? dyn_cast<VarDecl>(ref->getDecl()) : nullptr;
+}
+
+// li.name()
+static bool isIteratorCall(const Stmt *stmt, const VarDecl *iterator, StringRef name) {
+  const auto call = dyn_cast_or_null<CXXMemberCallExpr>(stmt);
+  if (call==nullptr || call->getMethodDecl()==nullptr) {
+    return false;
+  }
+  return call->getMethodDecl()->getName() == name && getRefVar(call->getImplicitObjectArgument()) == iterator;
+}
+
+// ++li / li++
+static bool isIteratorIncrement(const Stmt *stmt, const VarDecl *iterator) {
+  const auto op = dyn_cast_or_null<CXXOperatorCallExpr>(stmt);
+  if (op==nullptr || op->getOperator() != OO_PlusPlus || op->getNumArgs()==0) {
+    return false;
+  }
+  return getRefVar(op->getArg(0)) == iterator;
+}
+
+// (a=li.current()) or (a=li.current())!=0, fills element and iterator
+static bool matchCurrentAssign(ASTContext &Context, const Expr *e, IteratorLoop &loop) {
+  auto op = dyn_cast<BinaryOperator>(e->IgnoreParenImpCasts());
+  if (op && op->getOpcode() == BO_NE && op->getRHS()->isNullPointerConstant(Context, Expr::NPC_ValueDependentIsNull)) {
+    op = dyn_cast<BinaryOperator>(op->getLHS()->IgnoreParenImpCasts());
+  }
+  if (op==nullptr || op->getOpcode() != BO_Assign) {
+    return false;
+  }
+  const auto call = dyn_cast<CXXMemberCallExpr>(op->getRHS()->IgnoreParenImpCasts());
+  if (call==nullptr || call->getMethodDecl()==nullptr || call->getMethodDecl()->getName() != "current") {
+    return false;
+  }
+  loop.element = getRefVar(op->getLHS());
+  loop.iterator = getRefVar(call->getImplicitObjectArgument());
+  return loop.element && loop.iterator;
+}
+
+// [cond &&] (a=li.current()) [&& cond], the other side of && is the exit condition
+static bool matchLoopCondition(ASTContext &Context, const Expr *cond, IteratorLoop &loop) {
+  const auto land = dyn_cast<BinaryOperator>(cond->IgnoreParenImpCasts());
+  if (land && land->getOpcode() == BO_LAnd) {
+    if (matchCurrentAssign(Context, land->getRHS(), loop)) {
+      loop.exitCond = land->getLHS();
+      return true;
+    }
+    if (matchCurrentAssign(Context, land->getLHS(), loop)) {
+      loop.exitCond = land->getRHS();
+      return true;
+    }
+    return false;
+  }
+  return matchCurrentAssign(Context, cond, loop);
+}
+
+static const Stmt *getPreviousStmt(ASTContext &Context, const Stmt *stmt) {
+  const auto parents = Context.getParents(*stmt);
+  const auto block = parents.empty() ? nullptr : parents[0].get<CompoundStmt>();
+  if (block==nullptr) {
+    return nullptr;
+  }
+  const Stmt *prev = nullptr;
+  for (auto child : block->body()) {
+    if (child == stmt) return prev;
+    prev = child;
+  }
+  return nullptr;
+}
+
+static const FunctionDecl *getEnclosingFunction(ASTContext &Context, const Stmt *stmt) {
+  auto parents = Context.getParents(*stmt);
+  while (!parents.empty()) {
+    if (auto fn = parents[0].get<FunctionDecl>()) return fn;
+    if (auto parent = parents[0].get<Stmt>()) {
+      parents = Context.getParents(*parent);
+    } else if (auto parent = parents[0].get<Decl>()) {
+      parents = Context.getParents(*parent);
+    } else {
+      return nullptr;
+    }
+  }
+  return nullptr;
+}
+
+// true when the first use of 'var' after 'stmt' overwrites it; a loop
+// around 'stmt' runs whatever uses 'var' in front of it again afterwards
+static bool isDeadAfter(ASTContext &Context, const Stmt *stmt, const VarDecl *var) {
+  const auto &SourceManager = Context.getSourceManager();
+  const auto fn = getEnclosingFunction(Context, stmt);
+  if (fn==nullptr) {
+    return false;
+  }
+  for (auto loop = getEnclosingLoop(Context, stmt); loop; loop = getEnclosingLoop(Context, loop)) {
+    for (auto ref : findRefs(loop, var)) {
+      if (SourceManager.isBeforeInTranslationUnit(ref->getLocStart(), stmt->getLocStart())) return false;
+    }
+  }
+  for (auto ref : findRefs(fn->getBody(), var)) {
+    if (!SourceManager.isBeforeInTranslationUnit(stmt->getLocEnd(), ref->getLocStart())) continue;
+    const auto parents = Context.getParents(*ref);
+    const auto op = parents.empty() ? nullptr : parents[0].get<BinaryOperator>();
+    return op && op->getOpcode() == BO_Assign && op->getLHS()->IgnoreParens() == ref;
+  }
+  return true;
+}
+
+// the loop header: iterator, element, container and a walk from the first element
+static bool matchIteratorHeader(ASTContext &Context, const Stmt *stmt, IteratorLoop &loop) {
+  if (stmt->getLocStart().isMacroID()) {
+    return false;
+  }
+  const Expr *cond = nullptr;
+  const Stmt *init = nullptr;
+  if (const auto forStmt = dyn_cast<ForStmt>(stmt)) {
+    if (forStmt->getConditionVariable()) return false;
+    cond = forStmt->getCond();
+    init = forStmt->getInit();
+    loop.inc = forStmt->getInc();
+    loop.body = forStmt->getBody();
+  } else if (const auto whileStmt = dyn_cast<WhileStmt>(stmt)) {
+    if (whileStmt->getConditionVariable()) return false;
+    cond = whileStmt->getCond();
+    loop.body = whileStmt->getBody();
+  } else {
+    return false;
+  }
+  loop.loop = stmt;
+  if (cond==nullptr || loop.body==nullptr) {
+    return false;
+  }
+
+  if (!matchLoopCondition(Context, cond, loop)) {
+    return false;
+  }
+  if (!loop.element->isLocalVarDecl() || loop.element->isStaticLocal()) {
+    return false;
+  }
+  const auto iteratorType = loop.iterator->getType()->getAsCXXRecordDecl();
+  loop.isDict = isDerivedFromName(iteratorType, "QDictIterator");
+  if (!loop.isDict && !isDerivedFromName(iteratorType, "QListIterator")) {
+    return false;
+  }
+
+  // the container comes from the iterator constructor: QListIterator<T> li(list)
+  const auto construct = dyn_cast_or_null<CXXConstructExpr>(loop.iterator->getInit() ? loop.iterator->getInit()->IgnoreImplicit() : nullptr);
+  if (construct==nullptr || construct->getNumArgs()==0) {
+    return false;
+  }
+  loop.container = construct->getArg(0)->IgnoreParenImpCasts();
+  if (!isTranslatedContainer(loop.container, loop.isDict)) {
+    return false;
+  }
+
+  // the walk has to start at the first element
+  if (init) {
+    if (!isIteratorCall(init, loop.iterator, "toFirst")) return false;
+  } else {
+    auto prev = getPreviousStmt(Context, stmt);
+    if (prev && isIteratorCall(prev, loop.iterator, "toFirst")) {
+      loop.rewind = prev;
+    } else {
+      // or a fresh iterator, only declarations between it and the loop
+      const DeclStmt *declStmt = nullptr;
+      while ((declStmt = dyn_cast_or_null<DeclStmt>(prev))) {
+        if (std::find(declStmt->decl_begin(), declStmt->decl_end(), loop.iterator) != declStmt->decl_end()) break;
+        prev = getPreviousStmt(Context, prev);
+      }
+      if (declStmt==nullptr) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static bool matchIteratorLoop(ASTContext &Context, const Stmt *stmt, IteratorLoop &loop) {
+  const auto &SourceManager = Context.getSourceManager();
+  if (!matchIteratorHeader(Context, stmt, loop)) {
+    return false;
+  }
+  if (isa<ForStmt>(stmt) && !isIteratorIncrement(loop.inc, loop.iterator)) {
+    return false;
+  }
+  if (isa<WhileStmt>(stmt)) {
+    const auto block = dyn_cast<CompoundStmt>(loop.body);
+    if (block==nullptr || block->body_empty() || !isIteratorIncrement(block->body_back(), loop.iterator)) {
+      return false;
+    }
+    loop.advance = block->body_back();
+  }
+  // a body without braces gets them when a prologue goes in front of it; a
+  // nested loop rewritten the same way would end at the same spot, and its
+  // closing brace and ours would be one replacement
+  if (isa<ForStmt>(loop.body) || isa<WhileStmt>(loop.body)) {
+    return false;
+  }
+
+  // the body may not touch the iterator except for currentKey() of a dict
+  for (auto ref : findRefs(loop.body, loop.iterator)) {
+    if (contains(SourceManager, loop.advance, ref->getLocStart())) continue;
+    const auto parents = Context.getParents(*ref);
+    const auto member = parents.empty() ? nullptr : parents[0].get<MemberExpr>();
+    const auto memberParents = member ? Context.getParents(*member) : parents;
+    const auto call = (member && !memberParents.empty()) ? memberParents[0].get<CXXMemberCallExpr>() : nullptr;
+    if (!loop.isDict || !isIteratorCall(call, loop.iterator, "currentKey")) {
+      return false;
+    }
+    loop.keys.push_back(call);
+  }
+  if (loop.exitCond && (!findRefs(loop.exitCond, loop.iterator).empty() || !findRefs(loop.exitCond, loop.element).empty())) {
+    return false;
+  }
+  // RangeForCb copies cond into the body as it is
+  if (hasTranslatedCall(loop.exitCond)) {
+    return false;
+  }
+  // removing from the container while walking it invalidates the range-based for
+  if (const auto containerDecl = getObjectDecl(loop.container)) {
+    for (auto ref : findRefs(loop.body, containerDecl)) {
+      const auto parents = Context.getParents(*ref);
+      const auto member = parents.empty() ? nullptr : parents[0].get<MemberExpr>();
+      const auto method = member ? dyn_cast<CXXMethodDecl>(member->getMemberDecl()) : nullptr;
+      if (method==nullptr || !method->isConst()) return false;
+    }
+  }
+  // a loop left through cond keeps the last element in a, the range-based
+  // for can only replace it if nobody looks at a afterwards
+  return isDeadAfter(Context, stmt, loop.element);
+}
+
+// a method of QList itself, not one of the same name a class inheriting it declares: find(const char *)
+static bool isQListMethod(const CXXMemberCallExpr *call) {
+  const auto method = call->getMethodDecl();
+  return method && method->getParent()->getName() == "QList";
+}
+
+// classes overriding compareValues() make find()/remove() compare values, not pointers
+static bool hasCompareValues(const CXXRecordDecl *decl) {
+  if (decl==nullptr || decl->getName() == "QList") {
+    return false;
+  }
+  if (!decl->hasDefinition()) return false; // this is needed so bases_begin doesn't crash
+  for (auto method : decl->methods()) {
+    if (method->getName() == "compareValues" || method->getName() == "compareItems") return true;
+  }
+  for (auto it = decl->bases_begin(); it != decl->bases_end(); ++it) {
+    if (hasCompareValues(it->getType()->getAsCXXRecordDecl())) return true;
+  }
+  return false;
+}
+
+// the only statement of a block, or the statement itself
+static const Stmt *getSingleStmt(const Stmt *stmt) {
+  if (const auto block = dyn_cast_or_null<CompoundStmt>(stmt)) {
+    stmt = block->size()==1 ? block->body_front() : nullptr;
+  }
+  if (const auto expr = dyn_cast_or_null<Expr>(stmt)) {
+    return expr->IgnoreImplicit();
+  }
+  return stmt;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Pruning a list while walking it:
+//   for (li.toFirst(); (a=li.current()); ) { if (cond) list.remove(a); else ++li; }
+//   while ((a=li.current())) { if (cond) list.remove(a); else ++li; }
+// QListIterator moves on by itself when its current element is removed.
+// Translating the remove() alone would search the list again for every
+// element that goes, O(n^2); list.remove_if() is a single pass.
+////////////////////////////////////////////////////////////////////////////////
+static bool matchRemoveLoop(ASTContext &Context, const Stmt *stmt, IteratorLoop &loop) {
+  if (!matchIteratorHeader(Context, stmt, loop) || loop.isDict || loop.exitCond || loop.inc) {
+    return false;
+  }
+  const auto test = dyn_cast_or_null<IfStmt>(getSingleStmt(loop.body));
+  if (test==nullptr || test->getConditionVariable() || test->getElse()==nullptr) {
+    return false;
+  }
+  if (!isIteratorIncrement(getSingleStmt(test->getElse()), loop.iterator)) return false;
+  // list.remove() without argument removes the current item of the list, not of li
+  const auto call = dyn_cast_or_null<CXXMemberCallExpr>(getSingleStmt(test->getThen()));
+  if (call==nullptr || !isQListMethod(call) || call->getNumArgs()!=1) {
+    return false;
+  }
+  const auto name = call->getMethodDecl()->getName();
+  if (name != "removeRef" && !(name == "remove" && !hasCompareValues(call->getRecordDecl()))) return false;
+  if (getRefVar(call->getArg(0)) != loop.element) return false;
+  const auto containerDecl = getObjectDecl(loop.container);
+  if (containerDecl==nullptr || getObjectDecl(call->getImplicitObjectArgument()) != containerDecl) {
+    return false;
+  }
+  // the predicate runs while remove_if() holds the list
+  loop.removeCall = call;
+  loop.removeCond = test->getCond();
+  if (!findRefs(loop.removeCond, loop.iterator).empty() || !findRefs(loop.removeCond, containerDecl).empty()) {
+    return false;
+  }
+  // RemoveIfCb copies cond into the lambda as it is
+  if (hasTranslatedCall(loop.removeCond)) {
+    return false;
+  }
+  return isDeadAfter(Context, stmt, loop.element);
+}
+
+// references that vanish with the loop header or get rebound to the new loop variable
+static void collectRangeForRefs(const SourceManager &SourceManager, const IteratorLoop &loop) {
+  g_range_for_refs.insert(declKey(SourceManager, loop.iterator));
+  g_range_for_refs.insert(declKey(SourceManager, loop.element));
+  for (auto ref : findRefs(loop.loop, loop.iterator)) {
+    g_range_for_refs.insert(locKey(SourceManager, ref->getExprLoc()));
+  }
+  if (loop.rewind) {
+    for (auto ref : findRefs(loop.rewind, loop.iterator)) {
+      g_range_for_refs.insert(locKey(SourceManager, ref->getExprLoc()));
+    }
+  }
+  for (auto ref : findRefs(loop.loop, loop.element)) {
+    g_range_for_refs.insert(locKey(SourceManager, ref->getExprLoc()));
+  }
+}
+
+// T *a
+static std::string declText(const VarDecl *var) {
+  std::string str = typeName(var->getType());
+  if (str.back() != '*' && str.back() != '&') str += " ";
+  return str + var->getName().str();
+}
+
+class CollectRangeForCb : public ast_matchers::MatchFinder::MatchCallback {
+public:
+    virtual void run(const ast_matchers::MatchFinder::MatchResult &result) {
+      const auto stmt = result.Nodes.getNodeAs<Stmt>("iteratorLoop");
+      if (stmt==nullptr) {
+        return;
+      }
+      IteratorLoop loop;
+      if (!matchIteratorLoop(*result.Context, stmt, loop)) {
+        loop = IteratorLoop();
+        if (!matchRemoveLoop(*result.Context, stmt, loop)) return;
+      }
+      collectRangeForRefs(*result.SourceManager, loop);
+    }
+};
+
+class RangeForCb : public BaseMatcherCb {
+public:
+    RangeForCb(tooling::Replacements *r) : BaseMatcherCb(r) {}
+
+    virtual void run(const ast_matchers::MatchFinder::MatchResult &result) {
+      const auto stmt = result.Nodes.getNodeAs<Stmt>("iteratorLoop");
+      if (stmt==nullptr) {
+        return;
+      }
+      IteratorLoop loop;
+      if (!matchIteratorLoop(*result.Context, stmt, loop)) return;
+      const auto &sm = *result.SourceManager;
+
+      std::string element = declText(loop.element);
+      std::string container = getText(sm, *loop.container);
+
+      std::string header;
+      std::vector<std::string> prologue;
+      if (loop.exitCond) {
+        const auto notCond = dyn_cast<UnaryOperator>(loop.exitCond->IgnoreParenImpCasts());
+        if (notCond && notCond->getOpcode() == UO_LNot) {
+          prologue.push_back("if (" + getText(sm, *notCond->getSubExpr()->IgnoreParens()) + ") break;");
+        } else {
+          prologue.push_back("if (!(" + getText(sm, *loop.exitCond) + ")) break;");
+        }
+      }
+      if (loop.isDict) {
+        std::string entry = loop.element->getName().str() + "Entry";
+        header = "for (const auto &" + entry + " : " + container + ")";
+        prologue.push_back(element + " = " + entry + ".second;");
+        for (auto key : loop.keys) {
+          Replace->insert(Replacement(sm, key, entry + ".first"));
+        }
+      } else if (isOwningObject(sm, loop.container)) {
+        std::string owner = loop.element->getName().str() + "Owner";
+        header = "for (const auto &" + owner + " : " + container + ")";
+        prologue.push_back(element + " = " + owner + ".get();");
+      } else {
+        header = "for (" + element + " : " + container + ")";
+      }
+
+      auto bodyStart = sm.getSpellingLoc(loop.body->getLocStart());
+      auto headerRange = CharSourceRange::getCharRange(sm.getSpellingLoc(stmt->getLocStart()), bodyStart);
+      const auto block = dyn_cast<CompoundStmt>(loop.body);
+      if (prologue.empty()) {
+        Replace->insert(Replacement(sm, headerRange, header + " "));
+      } else if (block) {
+        unsigned column = block->body_empty() ? sm.getSpellingColumnNumber(stmt->getLocStart()) + 2
+                                              : sm.getSpellingColumnNumber(block->body_front()->getLocStart());
+        std::string text;
+        for (const auto &line : prologue) {
+          text += "\n" + std::string(column - 1, ' ') + line;
+        }
+        Replace->insert(Replacement(sm, headerRange, header + " "));
+        Replace->insert(Replacement(sm, bodyStart.getLocWithOffset(1), 0, text));
+      } else {
+        std::string text;
+        for (const auto &line : prologue) {
+          text += " " + line;
+        }
+        Replace->insert(Replacement(sm, headerRange, header + " {" + text + " "));
+        Replace->insert(Replacement(sm, getStmtEnd(sm, loop.body), 0, " }"));
+      }
+      if (loop.advance) {
+        Replace->insert(Replacement(sm, getStmtLineRange(sm, loop.advance), ""));
+      }
+      if (loop.rewind) {
+        Replace->insert(Replacement(sm, getStmtLineRange(sm, loop.rewind), ""));
+      }
+    }
+};
+
+// iterators and loop variables only used by loops that became range-based for
+class RangeForDeclCb : public BaseMatcherCb {
+public:
+    RangeForDeclCb(tooling::Replacements *r) : BaseMatcherCb(r) {}
+
+    virtual void run(const ast_matchers::MatchFinder::MatchResult &result) {
+      const auto declStmt = result.Nodes.getNodeAs<DeclStmt>("rangeForDecl");
+      if (declStmt==nullptr || !declStmt->isSingleDecl()) {
+        return;
+      }
+      const auto var = dyn_cast<VarDecl>(declStmt->getSingleDecl());
+      if (var==nullptr || !isConsumedByRangeFor(*result.SourceManager, var)) {
+        return;
+      }
+      Replace->insert(Replacement(*result.SourceManager, getStmtLineRange(*result.SourceManager, declStmt), ""));
+    }
+};
+
+class RemoveIfCb : public BaseMatcherCb {
+public:
+    RemoveIfCb(tooling::Replacements *r) : BaseMatcherCb(r) {}
+
+    virtual void run(const ast_matchers::MatchFinder::MatchResult &result) {
+      const auto stmt = result.Nodes.getNodeAs<Stmt>("iteratorLoop");
+      if (stmt==nullptr) {
+        return;
+      }
+      IteratorLoop loop;
+      if (!matchRemoveLoop(*result.Context, stmt, loop)) return;
+      const auto &sm = *result.SourceManager;
+
+      std::string list;
+      const auto deref = dyn_cast<UnaryOperator>(loop.container);
+      if (deref && deref->getOpcode() == UO_Deref) {
+        list = getText(sm, *deref->getSubExpr()) + "->";
+      } else {
+        list = getText(sm, *loop.container) + ".";
+      }
+      std::string cond = getText(sm, *loop.removeCond);
+      std::string lambda;
+      if (isOwningObject(sm, loop.container)) {
+        std::string owner = loop.element->getName().str() + "Owner";
+        lambda = "[&](const std::unique_ptr<" + typeName(loop.element->getType()->getPointeeType()) + "> &" + owner + ") { " +
+                 declText(loop.element) + " = " + owner + ".get(); return " + cond + "; }";
+      } else {
+        lambda = "[&](" + declText(loop.element) + ") { return " + cond + "; }";
+      }
+      auto range = CharSourceRange::getCharRange(sm.getSpellingLoc(stmt->getLocStart()), getStmtEnd(sm, stmt));
+      Replace->insert(Replacement(sm, range, list + "remove_if(" + lambda + ");"));
+      if (loop.rewind) {
+        Replace->insert(Replacement(sm, getStmtLineRange(sm, loop.rewind), ""));
+      }
+    }
+};
+
+// the list.remove(a) of a loop RemoveIfCb replaces as a whole is left to it
+static bool isConsumedByRemoveIf(ASTContext &Context, const CXXMemberCallExpr *call) {
+  const auto loop = getEnclosingLoop(Context, call);
+  IteratorLoop removeLoop;
+  return loop && matchRemoveLoop(Context, loop, removeLoop) && removeLoop.removeCall == call;
+}
+
+// Collects the QListIterator variables used below a statement.
+class IteratorRefCollector : public RecursiveASTVisitor<IteratorRefCollector> {
+public:
+    bool VisitDeclRefExpr(DeclRefExpr *ref) {
+      const auto var = dyn_cast<VarDecl>(ref->getDecl());
+      if (var && isDerivedFromName(var->getType()->getAsCXXRecordDecl(), "QListIterator")) Iterators.push_back(var);
+      return true;
+    }
+
+    std::vector<const VarDecl*> Iterators;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// True when 'call' runs inside a loop whose header walks the list of
+// 'listDecl' with a QListIterator, in any shape RemoveIfCb does not replace:
+//   for (li.toFirst(); (a=li.current()); ) { if (c) { l.remove(a); n++; } else ++li; }
+// QListIterator moved on by itself, erasing the node a std::list iterator
+// stands on leaves it dangling.
+////////////////////////////////////////////////////////////////////////////////
+static bool isInIteratorLoop(ASTContext &Context, const Stmt *call, const Decl *listDecl) {
+  if (listDecl==nullptr) {
+    return false;
+  }
+  for (auto loop = getEnclosingLoop(Context, call); loop; loop = getEnclosingLoop(Context, loop)) {
+    IteratorRefCollector collector;
+    const Stmt *header[3] = {};
+    if (const auto forStmt = dyn_cast<ForStmt>(loop)) {
+      header[0] = forStmt->getInit();
+      header[1] = forStmt->getCond();
+      header[2] = forStmt->getInc();
+    } else if (const auto whileStmt = dyn_cast<WhileStmt>(loop)) {
+      header[0] = whileStmt->getCond();
+    } else if (const auto doStmt = dyn_cast<DoStmt>(loop)) {
+      header[0] = doStmt->getCond();
+    }
+    for (auto stmt : header) {
+      if (stmt) collector.TraverseStmt(const_cast<Stmt*>(stmt));
+    }
+    for (auto iterator : collector.Iterators) {
+      if (getIteratedDecl(iterator) == listDecl) return true;
+    }
+  }
+  return false;
+}
+
+// the list of a member call, as argument of a qstl:: helper: list, *m_list, *this
+static std::string listRef(const SourceManager &SourceManager, const Expr *object) {
+  if (object->isImplicitCXXThis()) {
+    return "*this";
+  }
+  auto str = getText(SourceManager, *object);
+  return object->getType()->isPointerType() ? "*" + str : str;
+}
+
+// the list of a member call, as prefix of a std::list member: list., m_list->
+static std::string listAccess(const SourceManager &SourceManager, const Expr *object) {
+  if (object->isImplicitCXXThis()) {
+    return "";
+  }
+  auto str = getText(SourceManager, *object);
+  return str + (object->getType()->isPointerType() ? "->" : ".");
+}
+
+// QList::remove() returns FALSE for a missing item or an index out of range,
+// the helpers check for both and keep that for callers that look at it
+class RemoveCb : public BaseMatcherCb {
+public:
+    RemoveCb(tooling::Replacements *r) : BaseMatcherCb(r) {}
+
+    virtual void run(const ast_matchers::MatchFinder::MatchResult &result) {
+      const auto call = result.Nodes.getNodeAs<CXXMemberCallExpr>("qlist::remove");
+      if (call==nullptr || !isQListMethod(call) || call->getNumArgs()!=1) {
+        return;
+      }
+      const auto &sm = *result.SourceManager;
+      if (isConsumedByRemoveIf(*result.Context, call)) return;
+      const auto object = call->getImplicitObjectArgument();
+      if (isInIteratorLoop(*result.Context, call, getObjectDecl(object))) {
+        llvm::errs() << locKey(sm, call->getLocStart()) << ": " << call->getMethodDecl()->getName()
+                     << "() on the list an iterator loop walks, not translated\n";
+        return;
+      }
+      const auto arg = call->getArg(0);
+      auto argStr = getText(sm, *arg);
+      if (arg->getType()->isIntegerType()) {
+        if (getEnclosingLoop(*result.Context, call)) {
+          llvm::errs() << locKey(sm, call->getLocStart()) << ": remove(index) inside a loop walks the std::list on every call\n";
+        }
+        // checks the range like QList::remove() did, std::next() past the end is undefined
+        Replace->insert(Replacement(sm, call, "qstl::eraseAt(" + listRef(sm, object) + ", " + argStr + ")"));
+        return;
+      }
+      if (call->getMethodDecl()->getName() == "remove" && hasCompareValues(call->getRecordDecl())) {
+        llvm::errs() << locKey(sm, call->getLocStart()) << ": remove(item) compares with compareValues(), not translated\n";
+        return;
+      }
+      Replace->insert(Replacement(sm, call, "qstl::eraseFirst(" + listRef(sm, object) + ", " + argStr + ")"));
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Returns the comparison when the index only tells whether the item is there:
+//   l.findRef(x)==-1, !=-1, <0, >=0
+////////////////////////////////////////////////////////////////////////////////
+static const BinaryOperator *getFoundTest(ASTContext &Context, const Expr *call, bool &found) {
+  auto parents = Context.getParents(*call);
+  while (!parents.empty() && (parents[0].get<ImplicitCastExpr>() || parents[0].get<ParenExpr>())) {
+    parents = Context.getParents(*parents[0].get<Expr>());
+  }
+  const auto op = parents.empty() ? nullptr : parents[0].get<BinaryOperator>();
+  if (op==nullptr || op->getLHS()->IgnoreParenImpCasts() != call) {
+    return nullptr;
+  }
+  llvm::APSInt value;
+  if (!op->getRHS()->EvaluateAsInt(value, Context)) {
+    return nullptr;
+  }
+  switch (op->getOpcode()) {
+    case BO_EQ: found = false; return value == -1 ? op : nullptr;
+    case BO_NE: found = true;  return value == -1 ? op : nullptr;
+    case BO_LE: found = false; return value == -1 ? op : nullptr;
+    case BO_GT: found = true;  return value == -1 ? op : nullptr;
+    case BO_LT: found = false; return value == 0 ? op : nullptr;
+    case BO_GE: found = true;  return value == 0 ? op : nullptr;
+    default: return nullptr;
+  }
+}
+
+class FindRefCb : public BaseMatcherCb {
+public:
+    FindRefCb(tooling::Replacements *r) : BaseMatcherCb(r) {}
 
     virtual void run(const ast_matchers::MatchFinder::MatchResult &result) {
-      const auto decl = result.Nodes.getNodeAs<VarDecl>("varDeclIterator");
-      if (decl==nullptr) {
-        llvm::errs() <<"Unable to get decl\n";
+      const auto call = result.Nodes.getNodeAs<CXXMemberCallExpr>("qlist::findRef");
+      if (call==nullptr || !isQListMethod(call) || call->getNumArgs()!=1) {
         return;
       }
-      auto str = getText(*result.SourceManager,*decl);
-      if (! findNreplace(str,"QListIterator\\s*<\\s*(\\w+)\\s*>\\s*(\\w+)\\(\\*(.*)\\)","std::list<$1*>::iterator $2(@B$3->@Ebegin())") )
-      if (! findNreplace(str,"QListIterator\\s*<\\s*(\\w+)\\s*>\\s*(\\w+)\\((.*)\\)","std::list<$1*>::iterator $2(@B$3.@Ebegin())") )
-      if (! findNreplace(str,"QListIterator\\s*<\\s*(\\w+)\\s*>\\s*\\((.*)\\)","std::list<$1*>::iterator ($2->begin())") )
-      if (! findNreplace(str,"QListIterator\\s*<\\s*(\\w+)\\s*>","std::list<$1*>::iterator") )
-      if (! findNreplace(str,"(\\w+)ListIterator (\\w+)\\(\\*(.*)\\)","std::list<$1*>::iterator $2(@B$3->@Ebegin())") )
-      if (! findNreplace(str,"(\\w+)ListIterator (\\w+)\\((.*)\\)","std::list<$1*>::iterator $2(@B$3.@Ebegin())") )
-      if (! findNreplace(str,"(\\w+)ListIterator","std::list<$1*>::iterator") )
+      const auto &sm = *result.SourceManager;
+      if (call->getMethodDecl()->getName() == "find" && hasCompareValues(call->getRecordDecl())) {
+        llvm::errs() << locKey(sm, call->getLocStart()) << ": find(item) compares with compareValues(), not translated\n";
         return;
-      Replace->insert(Replacement(*result.SourceManager, decl, str));
+      }
+      const auto object = call->getImplicitObjectArgument();
+      const auto listDecl = getObjectDecl(object);
+      auto argStr = getText(sm, *call->getArg(0));
+      warnCurrent(*result.Context, call, listDecl);
+
+      bool found = false;
+      if (const auto test = getFoundTest(*result.Context, call, found)) {
+        // std::find() evaluates the list three times, only spell it out for plain variables
+        const auto plain = object->IgnoreParenImpCasts();
+        if (!isOwningObject(sm, object) && (isa<DeclRefExpr>(plain) || isa<MemberExpr>(plain) || isa<CXXThisExpr>(plain))) {
+          auto access = listAccess(sm, object);
+          Replace->insert(Replacement(sm, test, "std::find(" + access + "begin(), " + access + "end(), " + argStr + ")" +
+                                                (found ? "!=" : "==") + access + "end()"));
+        } else {
+          Replace->insert(Replacement(sm, test, (found ? "" : "!") + std::string("qstl::contains(") + listRef(sm, object) + ", " + argStr + ")"));
+        }
+        return;
+      }
+      Replace->insert(Replacement(sm, call, "qstl::indexOf(" + listRef(sm, object) + ", " + argStr + ")"));
     }
-};
-
-class IteratorCb : public BaseMatcherCb {
-public:
-    IteratorCb(tooling::Replacements *r) : BaseMatcherCb(r) {}
 
-    virtual void run(const ast_matchers::MatchFinder::MatchResult &result) {
-      const auto fdecl = result.Nodes.getNodeAs<CXXConstructExpr>("qlistIterator");
-      if (fdecl==nullptr) {
+private:
+    // findRef() also makes the item the current one of the list, std::list has no such thing
+    static void warnCurrent(ASTContext &Context, const CXXMemberCallExpr *call, const Decl *listDecl) {
+      const auto fn = getEnclosingFunction(Context, call);
+      if (fn==nullptr || listDecl==nullptr) {
         return;
       }
-      auto str = getText(*result.SourceManager,*fdecl);
-      if (! findNreplace(str, "QListIterator<(\\w+)>\\((\\w+)\\)", "std::list<$1*>::iterator(@B$2.@Ebegin())") )
-      if (! findNreplace(str,"(\\w+)ListIterator (\\w+)\\((.*)\\)","std::list<$1*>::iterator $2(@B$3.@Ebegin())") )
-        return;
-      Replace->insert(Replacement(*result.SourceManager, fdecl, str));
+      for (auto ref : findRefs(fn->getBody(), listDecl)) {
+        const auto parents = Context.getParents(*ref);
+        const auto member = parents.empty() ? nullptr : parents[0].get<MemberExpr>();
+        const auto method = member ? dyn_cast<CXXMethodDecl>(member->getMemberDecl()) : nullptr;
+        if (method && method->getNumParams()==0 &&
+            (method->getName() == "current" || method->getName() == "remove" || method->getName() == "take")) {
+          llvm::errs() << locKey(Context.getSourceManager(), call->getLocStart()) << ": findRef() result used through "
+                       << method->getName() << "(), check the translation\n";
+          return;
+        }
+      }
     }
 };
 
@@ -546,19 +2217,53 @@ public:
       if (fdecl==nullptr) {
         return;
       }
+      IteratorLoop loop;
+      if (matchIteratorLoop(*result.Context, fdecl, loop)) return; // see RangeForCb
+      loop = IteratorLoop();
+      if (matchRemoveLoop(*result.Context, fdecl, loop)) return; // see RemoveIfCb
       auto str = getText(*result.SourceManager,*fdecl);
       // for (ali.toFirst();!hasDocs && (a=ali.current());++ali)
       // for (ali.toFirst();!hasDocs && (ali!=this->end() && a=*ali);++ali)
       //-----
       // for (ali.toFirst();!hasDocs && (a=ali.current());++ali)
       // for (;(a=ali.current());++ali)
-      if (! findNreplace(str, "\\(.*\\.toFirst\\(\\);(.*)\\((\\w+)=(\\w+).current\\(\\)\\);", "(; $1 (@X$2,$3@Y); ") )
-      if (! findNreplace(str, "\\((\\w+)=(\\w+).current\\(\\)\\)", "(@X$1,$2@Y)") )
+      // an owning list yields std::unique_ptr, bexy.pl makes @O..@Y (a=ali->get())
+      std::string current = "@X";
+      loop = IteratorLoop();
+      if (fdecl->getCond() && matchLoopCondition(*result.Context, fdecl->getCond(), loop) &&
+          isOwningObject(*result.SourceManager, getIteratedObject(loop.iterator))) {
+        current = "@O";
+      }
+      if (! findNreplace(str, "\\(.*\\.toFirst\\(\\);(.*)\\((\\w+)=(\\w+).current\\(\\)\\);", "(; $1 (" + current + "$2,$3@Y); ") )
+      if (! findNreplace(str, "\\((\\w+)=(\\w+).current\\(\\)\\)", "(" + current + "$1,$2@Y)") )
         return;
       Replace->insert(Replacement(*result.SourceManager, fdecl, str));
     }
 };
 
+// the list walked by the iterator a method returns: return QListIterator<T>(*m_list);
+static const Decl *getReturnedIteratorDecl(const FunctionDecl *fn) {
+  auto value = getReturnValue(fn);
+  while (value) {
+    value = value->IgnoreImplicit();
+    if (const auto cast = dyn_cast<CXXFunctionalCastExpr>(value)) {
+      value = cast->getSubExpr();
+      continue;
+    }
+    const auto construct = dyn_cast<CXXConstructExpr>(value);
+    if (construct==nullptr || construct->getNumArgs()==0) {
+      return nullptr;
+    }
+    // the copy of the temporary that is returned
+    if (construct->getConstructor()->isCopyOrMoveConstructor()) {
+      value = construct->getArg(0);
+      continue;
+    }
+    return getObjectDecl(construct->getArg(0));
+  }
+  return nullptr;
+}
+
 // O:  - [x] return ref: QListIterator<T> & cxxMethodDecl()
 // O:  - [x] return ptr: QListIterator<T> * cxxMethodDecl()
 // O:  - [x] return obj: QListIterator<T>   cxxMethodDecl()
@@ -575,6 +2280,8 @@ public:
         return;
       }
       auto str = getText(*result.SourceManager,*decl);
+      // the iterator type follows the list it walks, std::pmr::list for one marked pmr
+      const auto type = listType(*result.SourceManager, getReturnedIteratorDecl(decl)) + "::iterator";
 
       std::string in = str;
       std::regex re("QListIterator\\s*<\\s*(\\w+)\\s*>\\s*\\((.*)\\)");
@@ -585,7 +2292,7 @@ public:
       {
         out += m.prefix();
         std::regex re("QListIterator\\s*<\\s*(\\w+)\\s*>\\s*\\(\\*(.*)\\)");
-        out += std::regex_replace(m[0].str(), re, "std::list<$1*>::iterator ($2->begin())");
+        out += std::regex_replace(m[0].str(), re, type + " ($2->begin())");
         in = m.suffix();
       }
       out += in;
@@ -597,7 +2304,7 @@ public:
       {
         out += m.prefix();
         std::regex re("QListIterator\\s*<\\s*(\\w+)\\s*>");
-        out += std::regex_replace(m[0].str(), re, "std::list<$1*>::iterator");
+        out += std::regex_replace(m[0].str(), re, type);
         in = m.suffix();
       }
       out += in;
@@ -608,8 +2315,39 @@ public:
 
 
 ////////////////////////////////////////////////////////////////////////////////
+namespace qintdict {
 // O:- [ ] QIntDict <T> -> std::map<T*>
 // O:  - [ ] QIntDict<T> -> std::unordered_map<long, T*>
+// O:  - [x] field declaration QIntDict -> std::unordered_map<long, T*>, qstl::flat_hash_map<long, T*>
+// O:    - [ ] insert(), find(), operator[], remove(), resize(); until then only with -intdict-backend or -backend-sites
+// No rule translates the calls on a QIntDict yet, a field only changes
+// when asked for: by -intdict-backend, or by its line in -backend-sites.
+class FieldDeclCb : public BaseMatcherCb {
+public:
+    FieldDeclCb(tooling::Replacements *r) : BaseMatcherCb(r) {}
+
+    virtual void run(const ast_matchers::MatchFinder::MatchResult &result) {
+      const auto decl = result.Nodes.getNodeAs<FieldDecl>("qintdict::fieldDecl");
+      if (decl==nullptr) {
+        llvm::errs() <<"Unable to get decl\n";
+        return;
+      }
+      if (IntDictBackend.getNumOccurrences()==0 && getBackendSite(*result.SourceManager, decl)==nullptr &&
+          !isPmr(*result.SourceManager, decl)) {
+        return;
+      }
+      auto str = getText(*result.SourceManager,*decl);
+      if (! findNreplace(str,"QIntDict\\s*<\\s*(\\w+)\\s*>",mapType(*result.SourceManager, decl, IntDictBackend, "long")) ) return;
+      if (str.find("std::pmr::") != std::string::npos) str += arenaInit(decl);
+      Replacement rep(*result.SourceManager, decl, str);
+      if (g_unique_fdecl.find(decl) == g_unique_fdecl.end()) {
+        Replace->insert(rep);
+        g_unique_fdecl.insert(decl);
+      }
+    }
+};
+}; // namespace qintdict
+
 // O:  - [ ] constructor QIntDict<T> (N) -> std::unordered_map<T*>::reserve(N)
 // O:  - [ ] QIntDictIterator(9)
 // O:  - [ ] classes inheriting QIntDict(4)
@@ -623,7 +2361,519 @@ public:
 // O:- [ ] QStack
 // O:- [ ] QArray
 // O:- [ ] QMap
-// O:- [ ] QStringList
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Element conversions and join/split live in qstl/stringlist.h, which gets
+// copied next to the rewritten sources.
+namespace qstringlist {
+
+// O:- [ ] QStringList -> std::vector<std::string>
+static std::string vectorType(std::string str) {
+  findNreplace(str,"QStringList\\s*::\\s*ConstIterator","std::vector<std::string>::const_iterator");
+  findNreplace(str,"QStringList\\s*::\\s*Iterator","std::vector<std::string>::iterator");
+  findNreplace(str,"\\bQStringList\\b","std::vector<std::string>");
+  return str;
+}
+
+// the source range of the type of 'decl', without name and initializer
+static CharSourceRange getTypeRange(const DeclaratorDecl *decl) {
+  if (decl->getTypeSourceInfo()==nullptr) {
+    return CharSourceRange();
+  }
+  return CharSourceRange::getTokenRange(decl->getTypeSourceInfo()->getTypeLoc().getSourceRange());
+}
+
+static bool isStringList(const CXXRecordDecl *record) {
+  return record && record->getName() == "QStringList";
+}
+
+// the list of l[i] or the iterator of *it / it-> that becomes a std::vector<std::string> or one of its iterators
+static bool isTranslatedElementSource(const SourceManager &SourceManager, const Expr *e) {
+  e = e->IgnoreParenImpCasts();
+  if (isStringList(e->getType()->getAsCXXRecordDecl())) return true;
+  // l.begin(), l.fromLast()
+  if (const auto call = dyn_cast<CXXMemberCallExpr>(e)) {
+    return isStringList(call->getRecordDecl());
+  }
+  // QStringList::Iterator it, written that way, see DeclCb
+  const auto decl = dyn_cast_or_null<DeclaratorDecl>(getObjectDecl(e));
+  const auto range = decl ? getTypeRange(decl) : CharSourceRange();
+  if (range.isInvalid()) {
+    return false;
+  }
+  const auto str = getText(SourceManager, range.getBegin(), range.getEnd());
+  return vectorType(str) != str;
+}
+
+// l.append(x), l.join(x), QStringList::split(x, y): translated as a whole, they take a std::string as it is
+static bool isStringListCall(const CallExpr *call) {
+  const auto method = dyn_cast_or_null<CXXMethodDecl>(call->getDirectCallee());
+  if (method==nullptr) {
+    return false;
+  }
+  const auto member = dyn_cast<CXXMemberCallExpr>(call);
+  const auto record = member ? member->getRecordDecl() : method->getParent();
+  const auto name = method->getName();
+  return isStringList(record) && (name == "append" || name == "join" || name == "split");
+}
+
+static bool isNonConstRef(QualType type) {
+  return type->isLValueReferenceType() && !type->getPointeeType().isConstQualified();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// An element of a QStringList is a QString, one of std::vector<std::string>
+// a std::string. Tells what to do with the element read 'e' (*it, l[i],
+// l.first()):
+//    1 wrap it in qstl::fromStd(), the code around it expects a QString
+//    0 leave it, it goes back into a QStringList rule
+//   -1 it is changed in place or outlived, warned and left untranslated
+////////////////////////////////////////////////////////////////////////////////
+static int getElementUse(ASTContext &Context, const Expr *e) {
+  const auto &SourceManager = Context.getSourceManager();
+  const Expr *child = e;
+  auto parents = Context.getParents(*e);
+  while (!parents.empty() && (parents[0].get<ImplicitCastExpr>() || parents[0].get<ParenExpr>())) {
+    child = parents[0].get<Expr>();
+    parents = Context.getParents(*child);
+  }
+  if (parents.empty()) {
+    return 1;
+  }
+  std::string use;
+  if (const auto member = parents[0].get<MemberExpr>()) {
+    const auto method = dyn_cast<CXXMethodDecl>(member->getMemberDecl());
+    const auto memberParents = Context.getParents(*member);
+    const auto call = memberParents.empty() ? nullptr : memberParents[0].get<CXXMemberCallExpr>();
+    if (method && !method->isConst()) {
+      use = "changed by " + method->getName().str() + "()";
+    } else if (method && call && call->getType()->isPointerType() && getAssignedDecl(Context, call)) {
+      use = "kept as " + method->getName().str() + "() of a temporary QString";
+    }
+  } else if (const auto op = parents[0].get<UnaryOperator>()) {
+    if (op->getOpcode() == UO_AddrOf) use = "taken the address of";
+  } else if (const auto var = parents[0].get<VarDecl>()) {
+    if (isNonConstRef(var->getType())) use = "bound to a reference";
+  } else if (parents[0].get<ReturnStmt>()) {
+    const auto fn = qlist::getEnclosingFunction(Context, e);
+    if (fn && isNonConstRef(fn->getReturnType())) use = "returned by reference";
+  } else if (const auto call = parents[0].get<CallExpr>()) {
+    if (isStringListCall(call)) return 0;
+    const auto callee = call->getDirectCallee();
+    const auto method = dyn_cast_or_null<CXXMethodDecl>(callee);
+    // the object of an operator method is its first argument: *it = x, s += x
+    const unsigned skip = isa<CXXOperatorCallExpr>(call) && method ? 1 : 0;
+    for (unsigned i=0; callee && i<call->getNumArgs(); i++) {
+      if (call->getArg(i) != child) continue;
+      if (i < skip) {
+        if (!method->isConst()) use = "changed by operator" + std::string(getOperatorSpelling(cast<CXXOperatorCallExpr>(call)->getOperator()));
+      } else if (i-skip < callee->getNumParams() && isNonConstRef(callee->getParamDecl(i-skip)->getType())) {
+        use = "passed by reference";
+      }
+    }
+  } else if (const auto construct = parents[0].get<CXXConstructExpr>()) {
+    const auto ctor = construct->getConstructor();
+    for (unsigned i=0; i<construct->getNumArgs() && i<ctor->getNumParams(); i++) {
+      if (construct->getArg(i) == child && isNonConstRef(ctor->getParamDecl(i)->getType())) use = "passed by reference";
+    }
+  }
+  if (!use.empty()) {
+    llvm::errs() << locKey(SourceManager, e->getLocStart()) << ": QStringList element " << use
+                 << ", a std::string now, not translated\n";
+    return -1;
+  }
+  return 1;
+}
+
+// an argument a QStringList rule copies as it is, l.first() renamed on the way
+static std::string copiedArgText(const SourceManager &SourceManager, const Expr *arg) {
+  auto str = getText(SourceManager, *arg);
+  const auto call = dyn_cast<CXXMemberCallExpr>(arg->IgnoreParenImpCasts());
+  if (call && call->getNumArgs()==0 && isStringList(call->getRecordDecl())) {
+    if (! findNreplace(str, "\\bfirst\\s*\\(\\s*\\)$", "front()") )
+      findNreplace(str, "\\blast\\s*\\(\\s*\\)$", "back()");
+  }
+  return str;
+}
+
+// O:  - [x] element reads *it, it->, l[i] -> qstl::fromStd() where a QString is expected
+class ElementCb : public BaseMatcherCb {
+public:
+    ElementCb(tooling::Replacements *r) : BaseMatcherCb(r) {}
+
+    virtual void run(const ast_matchers::MatchFinder::MatchResult &result) {
+      const auto op = result.Nodes.getNodeAs<CXXOperatorCallExpr>("qstringlist::element");
+      if (op==nullptr || op->getNumArgs()==0 || op->getLocStart().isMacroID()) {
+        return;
+      }
+      const auto &sm = *result.SourceManager;
+      if (!isTranslatedElementSource(sm, op->getArg(0))) {
+        return;
+      }
+      if (getElementUse(*result.Context, op) != 1) {
+        return;
+      }
+      if (op->getOperator() == OO_Arrow) {
+        // it->latin1() -> qstl::fromStd(*it).latin1()
+        const auto parents = result.Context->getParents(*op);
+        const auto member = parents.empty() ? nullptr : parents[0].get<MemberExpr>();
+        if (member==nullptr) {
+          return;
+        }
+        auto range = CharSourceRange::getCharRange(sm.getSpellingLoc(op->getLocStart()), sm.getSpellingLoc(member->getMemberLoc()));
+        Replace->insert(Replacement(sm, range, "qstl::fromStd(*" + getText(sm, *op->getArg(0)) + ")."));
+        return;
+      }
+      Replace->insert(Replacement(sm, op, "qstl::fromStd(" + getText(sm, *op) + ")"));
+    }
+};
+
+// key of parameter 'index' of 'fn', shared by all of its redeclarations
+static std::string paramKey(const SourceManager &SourceManager, const FunctionDecl *fn, unsigned index) {
+  return declKey(SourceManager, fn->getCanonicalDecl()) + "#" + std::to_string(index);
+}
+
+// by-value parameters that are only read, see ReadOnlyParamCb
+std::unordered_set<std::string> g_readonly_param;
+
+// O:  - [x] read-only QStringList parameter -> const std::vector<std::string> &
+// Doxygen passes QStringLists by value; a copied std::vector<std::string>
+// copies every string, so parameters the function never changes are passed
+// by const reference. Virtual methods keep their signature, overrides
+// elsewhere would stop matching.
+class ReadOnlyParamCb : public ast_matchers::MatchFinder::MatchCallback {
+public:
+    virtual void run(const ast_matchers::MatchFinder::MatchResult &result) {
+      const auto param = result.Nodes.getNodeAs<ParmVarDecl>("qstringlist::byValueParam");
+      if (param==nullptr) {
+        return;
+      }
+      const auto fn = dyn_cast<FunctionDecl>(param->getDeclContext());
+      if (fn==nullptr || param->getType()->isReferenceType()) {
+        return;
+      }
+      // the parameter of a prototype never shows up in the body, look at the
+      // one of the definition; without it in this translation unit we cannot tell
+      const FunctionDecl *definition = nullptr;
+      if (!fn->hasBody(definition) || definition->getBody()==nullptr) {
+        return;
+      }
+      if (const auto method = dyn_cast<CXXMethodDecl>(definition)) {
+        if (method->isVirtual()) return;
+      }
+      const auto defParam = definition->getParamDecl(param->getFunctionScopeIndex());
+      for (auto ref : findRefs(definition->getBody(), defParam)) {
+        if (!isRead(*result.Context, ref)) return;
+      }
+      g_readonly_param.insert(paramKey(*result.SourceManager, definition, defParam->getFunctionScopeIndex()));
+    }
+
+private:
+    static bool isRead(ASTContext &Context, const Expr *ref) {
+      const auto parents = Context.getParents(*ref);
+      if (parents.empty()) {
+        return false;
+      }
+      if (const auto member = parents[0].get<MemberExpr>()) {
+        const auto method = dyn_cast<CXXMethodDecl>(member->getMemberDecl());
+        return method && method->isConst();
+      }
+      if (parents[0].get<CXXConstructExpr>()) {
+        return true; // copied
+      }
+      if (const auto op = parents[0].get<CXXOperatorCallExpr>()) {
+        const auto method = dyn_cast_or_null<CXXMethodDecl>(op->getDirectCallee());
+        if (method && op->getNumArgs() && op->getArg(0) == ref) return method->isConst();
+      }
+      if (const auto call = parents[0].get<CallExpr>()) {
+        const auto callee = call->getDirectCallee();
+        if (callee==nullptr) {
+          return false;
+        }
+        for (unsigned i=0; i<call->getNumArgs() && i<callee->getNumParams(); i++) {
+          if (call->getArg(i) != ref) continue;
+          auto type = callee->getParamDecl(i)->getType();
+          return !type->isReferenceType() || type->getPointeeType().isConstQualified();
+        }
+      }
+      return false;
+    }
+};
+
+// O:  - [x] variable, field and parameter declaration QStringList
+// O:  - [x] QStringList::Iterator -> std::vector<std::string>::iterator
+class DeclCb : public BaseMatcherCb {
+public:
+    DeclCb(tooling::Replacements *r) : BaseMatcherCb(r) {}
+
+    virtual void run(const ast_matchers::MatchFinder::MatchResult &result) {
+      const auto decl = result.Nodes.getNodeAs<DeclaratorDecl>("qstringlist::decl");
+      if (decl==nullptr) {
+        return;
+      }
+      const auto range = getTypeRange(decl);
+      if (range.isInvalid()) {
+        return;
+      }
+      auto str = getText(*result.SourceManager, range.getBegin(), range.getEnd());
+      auto out = vectorType(str);
+      const auto param = dyn_cast<ParmVarDecl>(decl);
+      const auto fn = param ? dyn_cast<FunctionDecl>(param->getDeclContext()) : nullptr;
+      if (fn && !param->getType()->isReferenceType() &&
+          g_readonly_param.find(paramKey(*result.SourceManager, fn, param->getFunctionScopeIndex())) != g_readonly_param.end()) {
+        // a const QStringList keeps its const, the type range does not cover it
+        out = param->getType().isLocalConstQualified() ? out + " &" : "const " + out + " &";
+      }
+      if (out == str) return;
+      Replace->insert(Replacement(*result.SourceManager, range, out));
+    }
+};
+
+// O:  - [x] return obj: QStringList functionDecl()
+class ReturnCb : public BaseMatcherCb {
+public:
+    ReturnCb(tooling::Replacements *r) : BaseMatcherCb(r) {}
+
+    virtual void run(const ast_matchers::MatchFinder::MatchResult &result) {
+      const auto fdecl = result.Nodes.getNodeAs<FunctionDecl>("qstringlist::return");
+      if (fdecl==nullptr) {
+        return;
+      }
+      const auto range = CharSourceRange::getTokenRange(fdecl->getReturnTypeSourceRange());
+      if (range.isInvalid()) {
+        return;
+      }
+      auto str = vectorType(getText(*result.SourceManager, range.getBegin(), range.getEnd()));
+      Replace->insert(Replacement(*result.SourceManager, range, str));
+    }
+};
+
+// O:  - [x] QStringList() temporary -> std::vector<std::string>()
+class TemporaryCb : public BaseMatcherCb {
+public:
+    TemporaryCb(tooling::Replacements *r) : BaseMatcherCb(r) {}
+
+    virtual void run(const ast_matchers::MatchFinder::MatchResult &result) {
+      const auto expr = dyn_cast_or_null<CXXTemporaryObjectExpr>(result.Nodes.getNodeAs<CXXConstructExpr>("qstringlist::temporary"));
+      if (expr==nullptr) {
+        return;
+      }
+      auto str = getText(*result.SourceManager,*expr);
+      if (! findNreplace(str,"^QStringList\\b","std::vector<std::string>") ) return;
+      Replace->insert(Replacement(*result.SourceManager, expr, str));
+    }
+};
+
+// true when 'ref' gets changed: i++, i=..., i+=..., &i
+static bool isWritten(ASTContext &Context, const Expr *ref) {
+  const auto parents = Context.getParents(*ref);
+  if (parents.empty()) {
+    return false;
+  }
+  if (const auto op = parents[0].get<UnaryOperator>()) {
+    return op->isIncrementDecrementOp() || op->getOpcode() == UO_AddrOf;
+  }
+  if (const auto op = parents[0].get<BinaryOperator>()) {
+    return op->isAssignmentOp() && op->getLHS()->IgnoreParens() == ref;
+  }
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// When append() runs once per iteration of a counted loop
+//   for (i=0; i<n; i++) l.append(x);
+// the number of elements is known up front: returns the loop and sets bound
+// to n, or returns nullptr.
+////////////////////////////////////////////////////////////////////////////////
+static const ForStmt *getCountedLoop(ASTContext &Context, const Stmt *call, const Expr *&bound) {
+  const Stmt *stmt = call;
+  auto parents = Context.getParents(*stmt);
+  // only blocks between the call and the loop, an if() would make n an upper bound
+  while (!parents.empty() && (parents[0].get<ExprWithCleanups>() || parents[0].get<CompoundStmt>())) {
+    stmt = parents[0].get<Stmt>();
+    parents = Context.getParents(*stmt);
+  }
+  const auto loop = parents.empty() ? nullptr : parents[0].get<ForStmt>();
+  if (loop==nullptr || loop->getBody() != stmt || loop->getInit()==nullptr || loop->getInc()==nullptr) {
+    return nullptr;
+  }
+  // i starts at 0: int i=0 or i=0
+  const VarDecl *var = nullptr;
+  const Expr *start = nullptr;
+  if (const auto declStmt = dyn_cast<DeclStmt>(loop->getInit())) {
+    var = declStmt->isSingleDecl() ? dyn_cast<VarDecl>(declStmt->getSingleDecl()) : nullptr;
+    start = var ? var->getInit() : nullptr;
+  } else if (const auto op = dyn_cast<BinaryOperator>(loop->getInit())) {
+    var = op->getOpcode() == BO_Assign ? qlist::getRefVar(op->getLHS()) : nullptr;
+    start = op->getRHS();
+  }
+  llvm::APSInt value;
+  if (var==nullptr || start==nullptr || !start->EvaluateAsInt(value, Context) || value != 0) {
+    return nullptr;
+  }
+  // and steps by 1: i++, ++i
+  const auto inc = dyn_cast<UnaryOperator>(loop->getInc());
+  if (inc==nullptr || !inc->isIncrementOp() || qlist::getRefVar(inc->getSubExpr()) != var) {
+    return nullptr;
+  }
+  for (auto ref : findRefs(loop->getBody(), var)) {
+    if (isWritten(Context, ref)) return nullptr;
+  }
+  const auto cond = dyn_cast_or_null<BinaryOperator>(loop->getCond() ? loop->getCond()->IgnoreParenImpCasts() : nullptr);
+  if (cond==nullptr || cond->getOpcode() != BO_LT || qlist::getRefVar(cond->getLHS()) != var) {
+    return nullptr;
+  }
+  // the bound is evaluated once more before the loop, so it has to be cheap and side effect free
+  bound = cond->getRHS()->IgnoreParenImpCasts();
+  if (!isa<DeclRefExpr>(bound) && !isa<IntegerLiteral>(bound) && !isa<MemberExpr>(bound)) {
+    return nullptr;
+  }
+  return loop;
+}
+
+// the append() calls on 'var' that run once per iteration of 'loop', in source order
+static std::vector<const CXXMemberCallExpr*> getCountedAppends(ASTContext &Context, const ForStmt *loop, const VarDecl *var) {
+  std::vector<const CXXMemberCallExpr*> appends;
+  for (auto ref : findRefs(loop->getBody(), var)) {
+    const auto parents = Context.getParents(*ref);
+    const auto member = parents.empty() ? nullptr : parents[0].get<MemberExpr>();
+    const auto memberParents = member ? Context.getParents(*member) : parents;
+    const auto call = (member && !memberParents.empty()) ? memberParents[0].get<CXXMemberCallExpr>() : nullptr;
+    const Expr *bound = nullptr;
+    if (call && call->getMethodDecl() && call->getMethodDecl()->getName() == "append" && getCountedLoop(Context, call, bound) == loop) {
+      appends.push_back(call);
+    }
+  }
+  return appends;
+}
+
+// O:  - [x] append(x) -> push_back(x)
+// O:  - [x] reserve() before append() in a counted loop, for a local list
+class AppendCb : public BaseMatcherCb {
+public:
+    AppendCb(tooling::Replacements *r) : BaseMatcherCb(r) {}
+
+    virtual void run(const ast_matchers::MatchFinder::MatchResult &result) {
+      const auto call = result.Nodes.getNodeAs<CXXMemberCallExpr>("qstringlist::append");
+      if (call==nullptr || call->getNumArgs()!=1) {
+        return;
+      }
+      const auto &sm = *result.SourceManager;
+      const auto arg = call->getArg(0)->IgnoreParenImpCasts();
+      auto argStr = copiedArgText(sm,arg);
+      auto argType = arg->getType();
+      if (!(argType->isPointerType() || argType->isArrayType() || typeName(argType).find("std::") == 0)) {
+        argStr = "qstl::toStd(" + argStr + ")";
+      }
+      auto str = getText(sm,*call);
+      if (! findNreplace(str,"append\\s*\\((.*)\\)","push_back(" + argStr + ")") ) return;
+      Replace->insert(Replacement(sm, call, str));
+
+      const Expr *bound = nullptr;
+      const auto loop = getCountedLoop(*result.Context, call, bound);
+      if (loop==nullptr) {
+        return;
+      }
+      // reserve() grows the vector by n each time it runs: a list that
+      // outlives the function (field, global, parameter, *this) or an outer
+      // loop would get it again and again, quadratic in the end. Only a
+      // local that is new each time.
+      const auto var = dyn_cast_or_null<VarDecl>(getObjectDecl(call->getImplicitObjectArgument()));
+      if (var==nullptr || !var->isLocalVarDecl() || var->isStaticLocal() ||
+          var->getType()->isPointerType() || var->getType()->isReferenceType()) {
+        return;
+      }
+      if (dyn_cast_or_null<FunctionDecl>(var->getParentFunctionOrMethod()) != qlist::getEnclosingFunction(*result.Context, loop)) {
+        return;
+      }
+      if (const auto outer = getEnclosingLoop(*result.Context, loop)) {
+        if (!contains(sm, outer, var->getLocation())) return;
+      }
+      // once per loop, for all the append() calls in it
+      const auto appends = getCountedAppends(*result.Context, loop, var);
+      if (appends.empty() || appends.front() != call) {
+        return;
+      }
+      auto count = getText(sm, *bound);
+      if (count.empty()) {
+        return;
+      }
+      const auto object = var->getName().str();
+      if (appends.size() > 1) count = std::to_string(appends.size()) + "*" + count;
+      // a negative n would turn into a huge size_t
+      auto reserve = (isa<IntegerLiteral>(bound) ? std::string() : "if (" + getText(sm, *bound) + " > 0) ") +
+        object + ".reserve(" + object + ".size()+" + count + ");\n" +
+        std::string(sm.getSpellingColumnNumber(loop->getLocStart()) - 1, ' ');
+      Replace->insert(Replacement(sm, sm.getSpellingLoc(loop->getLocStart()), 0, reserve));
+    }
+};
+
+// O:  - [x] count() -> size(), isEmpty() -> empty(), first() -> qstl::fromStd(front()), last() -> qstl::fromStd(back())
+class RenameCb : public BaseMatcherCb {
+public:
+    RenameCb(tooling::Replacements *r) : BaseMatcherCb(r) {}
+
+    virtual void run(const ast_matchers::MatchFinder::MatchResult &result) {
+      const auto call = result.Nodes.getNodeAs<CXXMemberCallExpr>("qstringlist::rename");
+      if (call==nullptr || call->getMethodDecl()==nullptr) {
+        return;
+      }
+      static const std::map<std::string, std::string> names = {
+        { "count", "size" }, { "isEmpty", "empty" }, { "first", "front" }, { "last", "back" }
+      };
+      const auto name = names.find(call->getMethodDecl()->getName().str());
+      if (name == names.end() || call->getNumArgs()) {
+        return;
+      }
+      if (name->first == "first" || name->first == "last") {
+        // the element is a std::string now, see getElementUse(); inside
+        // append() and split() copiedArgText() renames it
+        if (getElementUse(*result.Context, call) != 1) return;
+        auto str = getText(*result.SourceManager,*call);
+        if (! findNreplace(str,name->first + "\\s*\\(\\s*\\)$",name->second + "()") ) return;
+        Replace->insert(Replacement(*result.SourceManager, call, "qstl::fromStd(" + str + ")"));
+        return;
+      }
+      const auto callee = call->getCallee();
+      auto str = getText(*result.SourceManager,*callee);
+      if (! findNreplace(str,name->first + "$",name->second) ) return;
+      Replace->insert(Replacement(*result.SourceManager, callee, str));
+    }
+};
+
+// O:  - [x] join(sep) -> qstl::join(list, sep)
+// O:  - [x] QStringList::split(sep, str) -> qstl::split(sep, str)
+class JoinSplitCb : public BaseMatcherCb {
+public:
+    JoinSplitCb(tooling::Replacements *r) : BaseMatcherCb(r) {}
+
+    virtual void run(const ast_matchers::MatchFinder::MatchResult &result) {
+      const auto &sm = *result.SourceManager;
+      if (const auto call = result.Nodes.getNodeAs<CXXMemberCallExpr>("qstringlist::join")) {
+        const auto object = call->getImplicitObjectArgument();
+        if (object->isImplicitCXXThis() || call->getNumArgs()==0) {
+          return;
+        }
+        auto list = getText(sm,*object);
+        if (object->getType()->isPointerType()) list = "*" + list;
+        Replace->insert(Replacement(sm, call, "qstl::join(" + list + ", " + copiedArgText(sm,call->getArg(0)) + ")"));
+      } else if (const auto call = result.Nodes.getNodeAs<CallExpr>("qstringlist::split")) {
+        const auto callee = call->getDirectCallee();
+        if (callee==nullptr || callee->getNumParams()==0) {
+          return;
+        }
+        if (typeName(callee->getParamDecl(0)->getType()).find("QRegExp") != std::string::npos) return;
+        std::string args;
+        for (unsigned i=0; i<call->getNumArgs(); i++) {
+          if (isa<CXXDefaultArgExpr>(call->getArg(i))) break;
+          args += (i ? ", " : "") + copiedArgText(sm,call->getArg(i));
+        }
+        Replace->insert(Replacement(sm, call, "qstl::split(" + args + ")"));
+      }
+    }
+};
+}; // namespace qstringlist
 // O:- [ ] QVector
 // O:- [ ] QCache
 // O:  - [ ] QCacheIterator
@@ -649,6 +2899,8 @@ int main(int argc, const char **argv) {
   tooling::RefactoringTool Tool(*Compilations, SourcePaths);
 
   ast_matchers::MatchFinder Finder;
+  // collects facts that decide how a declaration is rewritten, see g_owning_decl
+  ast_matchers::MatchFinder Collector;
 
   auto recordDeclQList = cxxRecordDecl(isSameOrDerivedFrom(hasName("QList")));
 
@@ -700,33 +2952,37 @@ int main(int argc, const char **argv) {
   qlist::GetFirstCb cb21(&Tool.getReplacements());
   Finder.addMatcher(
       id("getFirst",
-        cxxMemberCallExpr(callee(memberExpr(member(hasName("getFirst")))), thisPointerType(cxxRecordDecl(hasName("QList"),isTemplateInstantiation() )))
+        cxxMemberCallExpr(callee(memberExpr(member(hasName("getFirst")))), thisPointerType(recordDeclQList))
         )
       ,&cb21);
 
   qlist::GetLastCb cb22(&Tool.getReplacements());
   Finder.addMatcher(
       id("getLast",
-        cxxMemberCallExpr(callee(memberExpr(member(hasName("getLast")))), thisPointerType(cxxRecordDecl(hasName("QList"),isTemplateInstantiation() )))
+        cxxMemberCallExpr(callee(memberExpr(member(hasName("getLast")))), thisPointerType(recordDeclQList))
         )
       ,&cb22);
 
   // match: QList::setAutoDelete(TRUE)
   // this is needed so I can use std::unique_ptr
-  qlist::FieldSetAutoDeleteTrueCb cb4(&Tool.getReplacements());
-  Finder.addMatcher(
-      id("Field_setAutoDeleteTRUE",
-        cxxConstructorDecl(forEachConstructorInitializer(forField( fieldDecl(hasType(namedDecl(hasName("QList")) )).bind("C")  )) )
-        // TODO: also catch hasType(pointsTo(namedDecl ...
-      )
-      ,&cb4);
+  auto setAutoDeleteQList = cxxMemberCallExpr( callee(memberExpr(member(hasName("setAutoDelete")))), thisPointerType(recordDeclQList));
+  auto setAutoDeleteDependent = callExpr();
+  qlist::CollectAutoDeleteCb collect_ad;
+  Collector.addMatcher(id("setAutoDelete", setAutoDeleteQList), &collect_ad);
+  Collector.addMatcher(id("setAutoDeleteDependent", setAutoDeleteDependent), &collect_ad);
+
+  // match: pointers and references bound to a list, they share its element type
+  auto listArgument = hasAnyArgument(anyOf(hasType(pointsTo(recordDeclQList)), hasType(recordDeclQList)));
+  qlist::CollectAliasCb collect_al;
+  Collector.addMatcher(id("aliasVar", varDecl(anyOf(hasType(pointsTo(recordDeclQList)), hasType(references(recordDeclQList))), hasInitializer(expr()))), &collect_al);
+  Collector.addMatcher(id("aliasAssign", binaryOperator(hasOperatorName("="), hasLHS(expr(hasType(pointsTo(recordDeclQList)))))), &collect_al);
+  Collector.addMatcher(id("aliasCall", callExpr(listArgument)), &collect_al);
+  Collector.addMatcher(id("aliasConstruct", cxxConstructExpr(listArgument)), &collect_al);
+  Collector.addMatcher(id("aliasCtor", cxxConstructorDecl(isDefinition())), &collect_al);
+
    qlist::SetAutoDeleteTrueCb cb4_1(&Tool.getReplacements());
-   Finder.addMatcher(
-     id("setAutoDeleteTRUE",
-       cxxMemberCallExpr( callee(memberExpr(member(hasName("setAutoDelete")))), thisPointerType(cxxRecordDecl(isSameOrDerivedFrom(hasName("QList")))))
-       //cxxMemberCallExpr( callee(memberExpr(member(hasName("setAutoDelete")))), hasAnyArgument( declRefExpr( to( namedDecl(hasName("TRUE"))))),on( declRefExpr( to( id("thisDecl",varDecl(anything()))))), thisPointerType(recordDeclQList))
-       )
-     ,&cb4_1);
+   Finder.addMatcher(id("setAutoDeleteTRUE", setAutoDeleteQList), &cb4_1);
+   Finder.addMatcher(id("setAutoDeleteTRUEDependent", setAutoDeleteDependent), &cb4_1);
 
    qlist::FieldDeclCb cb11(&Tool.getReplacements());
    Finder.addMatcher(
@@ -787,7 +3043,7 @@ int main(int argc, const char **argv) {
    qlist::IteratorCb cb6(&Tool.getReplacements());
    Finder.addMatcher(
        id("qlistIterator",
-         cxxConstructExpr(hasType(recordDeclQListIterator))
+         cxxConstructExpr(hasType(recordDeclQListIterator), anyOf(hasParent(varDecl().bind("qlistIteratorVar")), anything()))
          )
        ,&cb6);
 
@@ -799,6 +3055,33 @@ int main(int argc, const char **argv) {
         )
       ,&it_cb5);
 
+   auto iteratorLoop = stmt(anyOf(forStmt(), whileStmt()));
+   qlist::CollectRangeForCb collect_rf;
+   Collector.addMatcher(id("iteratorLoop", iteratorLoop), &collect_rf);
+
+   qlist::RangeForCb cb67(&Tool.getReplacements());
+   Finder.addMatcher(id("iteratorLoop", iteratorLoop), &cb67);
+
+   qlist::RangeForDeclCb cb68(&Tool.getReplacements());
+   Finder.addMatcher(id("rangeForDecl", declStmt()), &cb68);
+
+   qlist::RemoveIfCb cb69(&Tool.getReplacements());
+   Finder.addMatcher(id("iteratorLoop", iteratorLoop), &cb69);
+
+   qlist::RemoveCb cb70(&Tool.getReplacements());
+   Finder.addMatcher(
+       id("qlist::remove",
+         cxxMemberCallExpr(callee(memberExpr(member(anyOf(hasName("remove"), hasName("removeRef"))))), thisPointerType(recordDeclQList))
+         )
+       ,&cb70);
+
+   qlist::FindRefCb cb71(&Tool.getReplacements());
+   Finder.addMatcher(
+       id("qlist::findRef",
+         cxxMemberCallExpr(callee(memberExpr(member(anyOf(hasName("findRef"), hasName("find"))))), thisPointerType(recordDeclQList))
+         )
+       ,&cb71);
+
    qlist::ForStmtIteratorCb cb66(&Tool.getReplacements());
    Finder.addMatcher(
        id("forStmtIterator",
@@ -826,5 +3109,88 @@ int main(int argc, const char **argv) {
        )
      ,&qb11);
 
+  auto recordDeclQIntDict = cxxRecordDecl(isSameOrDerivedFrom(hasName("QIntDict")));
+  qintdict::FieldDeclCb qid1(&Tool.getReplacements());
+   Finder.addMatcher(
+     id("qintdict::fieldDecl",
+       fieldDecl(anyOf( hasType(pointsTo(recordDeclQIntDict) )  ,  hasType(recordDeclQIntDict)))
+       )
+     ,&qid1);
+
+  ///////////////////
+  auto recordDeclQStringList = cxxRecordDecl(hasName("QStringList"));
+  auto qstringListType = anyOf(hasType(recordDeclQStringList), hasType(references(recordDeclQStringList)), hasType(pointsTo(recordDeclQStringList)),
+                               hasType(cxxRecordDecl(anyOf(hasName("QValueListIterator"), hasName("QValueListConstIterator")))));
+
+  qstringlist::ReadOnlyParamCb collect_sl;
+  Collector.addMatcher(id("qstringlist::byValueParam", parmVarDecl(hasType(recordDeclQStringList))), &collect_sl);
+
+  qstringlist::DeclCb sl1(&Tool.getReplacements());
+  Finder.addMatcher(id("qstringlist::decl", declaratorDecl(qstringListType)), &sl1);
+
+  qstringlist::ReturnCb sl2(&Tool.getReplacements());
+  Finder.addMatcher(
+      id("qstringlist::return",
+        functionDecl(returns(anyOf(hasDeclaration(recordDeclQStringList), references(recordDeclQStringList), pointsTo(recordDeclQStringList))))
+        )
+      ,&sl2);
+
+  qstringlist::TemporaryCb sl3(&Tool.getReplacements());
+  Finder.addMatcher(id("qstringlist::temporary", cxxConstructExpr(hasType(recordDeclQStringList))), &sl3);
+
+  qstringlist::AppendCb sl4(&Tool.getReplacements());
+  Finder.addMatcher(
+      id("qstringlist::append",
+        cxxMemberCallExpr(callee(memberExpr(member(hasName("append")))), thisPointerType(recordDeclQStringList))
+        )
+      ,&sl4);
+
+  qstringlist::RenameCb sl5(&Tool.getReplacements());
+  Finder.addMatcher(
+      id("qstringlist::rename",
+        cxxMemberCallExpr(callee(memberExpr(member(anyOf(hasName("count"), hasName("isEmpty"), hasName("first"), hasName("last"))))), thisPointerType(recordDeclQStringList))
+        )
+      ,&sl5);
+
+  qstringlist::ElementCb sl7(&Tool.getReplacements());
+  Finder.addMatcher(
+      id("qstringlist::element",
+        cxxOperatorCallExpr(anyOf(hasOverloadedOperatorName("*"), hasOverloadedOperatorName("->"), hasOverloadedOperatorName("[]")),
+                            hasArgument(0, anyOf(hasType(recordDeclQStringList),
+                                                 hasType(cxxRecordDecl(anyOf(hasName("QValueListIterator"), hasName("QValueListConstIterator")))))))
+        )
+      ,&sl7);
+
+  qstringlist::JoinSplitCb sl6(&Tool.getReplacements());
+  Finder.addMatcher(
+      id("qstringlist::join",
+        cxxMemberCallExpr(callee(memberExpr(member(hasName("join")))), thisPointerType(recordDeclQStringList))
+        )
+      ,&sl6);
+  Finder.addMatcher(
+      id("qstringlist::split",
+        callExpr(callee(cxxMethodDecl(hasName("split"), ofClass(recordDeclQStringList))))
+        )
+      ,&sl6);
+
+   CollectCtorInitCb collect_ci;
+   if (!BackendSites.empty()) {
+     if (!loadBackendSites(BackendSites)) return 1;
+     Collector.addMatcher(id("ctorInit", cxxConstructorDecl(isDefinition())), &collect_ci);
+   }
+   CollectNewSiteCb collect_ns;
+   if (!ProfilePath.empty()) {
+     if (!loadProfile(ProfilePath)) return 1;
+     Collector.addMatcher(
+         id("profiledNew",
+           cxxNewExpr(hasType(pointsTo(cxxRecordDecl(isSameOrDerivedFrom(
+                 anyOf(hasName("QList"), hasName("QDict"), hasName("QIntDict"), hasName("QCache"), hasName("SDict")))))))
+           )
+         ,&collect_ns);
+   }
+
+   if (int ret = Tool.run(newFrontendActionFactory(&Collector).get())) {
+     return ret;
+   }
    return Tool.runAndSave(newFrontendActionFactory(&Finder).get());
 }
@@ -0,0 +1,414 @@
+//    Counting wrappers for the qtools containers, forced into every doxygen
+//    translation unit by the makefile 'p' target (-include qprofile.h).
+//
+//    QList, QDict, QIntDict, QCache, doxygen's SDict and their iterators are
+//    renamed to <name>Orig while the original headers are read, and the names
+//    are then taken by derived classes that forward every call and count it
+//    against the declaration site of the container. The site is where the
+//    constructor was called from: the declaration line of a variable, the line
+//    of a new expression, or the constructor of the class holding a member.
+//
+//    At exit one line per site is written to $QTOOLS_PROFILE (default
+//    qtools-profile.tsv):
+//
+//      site  container  element  instances  inserts  removes  lookups
+//      iterations  clears  peak  size_hist
+//
+//    'peak' is the largest size any instance reached, 'size_hist' counts
+//    instances by their peak size, 'lo:count' for peaks in [lo, 2*lo).
+//    The refactor tool reads the file with -profile.
+//
+//    Needs __builtin_FILE() and __builtin_LINE(): gcc 4.8 or clang 9.
+//    The counters are not atomic, doxygen's worker threads make them approximate.
+
+#ifndef QPROFILE_H
+#define QPROFILE_H
+
+#if defined(__cplusplus) && defined(__has_include)
+#if __has_include(<qlist.h>)
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace qprofile {
+
+enum { Buckets = 32 };
+
+struct Site {
+  std::string file;
+  int line;
+  const char *container;
+  std::string element;
+  long instances = 0;
+  long inserts = 0;
+  long removes = 0;
+  long lookups = 0;
+  long iterations = 0;
+  long clears = 0;
+  long peak = 0;
+  long hist[Buckets] = {};
+};
+
+// 0 for empty, k for sizes in [2^(k-1), 2^k)
+inline int bucket(long size) {
+  int b = 0;
+  while (size > 0 && b < Buckets-1) { size >>= 1; ++b; }
+  return b;
+}
+
+// "T = Foo" out of the signature of elementName<Foo>(): gcc writes
+// "... [with T = Foo]", clang "... [T = Foo]"
+inline std::string templateArgument(const char *signature) {
+  std::string str = signature;
+  auto begin = str.find("T = ");
+  if (begin == std::string::npos) {
+    return str;
+  }
+  begin += 4;
+  return str.substr(begin, str.find_first_of(";]", begin) - begin);
+}
+
+// the element type of a container, by name: typeid() would need it complete,
+// and doxygen declares many QList<Foo> members where Foo is only forward declared
+template<class T>
+inline const char *elementName() {
+  static const std::string name = templateArgument(__PRETTY_FUNCTION__);
+  return name.c_str();
+}
+
+class Registry {
+public:
+    static Registry &instance() {
+      // never destroyed, containers with static storage outlive any destructor
+      static Registry *registry = new Registry;
+      return *registry;
+    }
+
+    Site *site(const char *file, int line, const char *container, const char *element) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto &site = m_sites[Key(file, line, container, element)];
+      if (site==nullptr) {
+        site = new Site;
+        site->file = file;
+        site->line = line;
+        site->container = container;
+        site->element = element;
+      }
+      return site;
+    }
+
+private:
+    // file names are string literals, one per translation unit, dump() merges them
+    typedef std::pair<std::pair<const char*, int>, std::pair<const char*, const char*>> KeyBase;
+    struct Key : KeyBase {
+      Key(const char *file, int line, const char *container, const char *element)
+        : KeyBase(std::make_pair(file, line), std::make_pair(container, element)) {}
+    };
+    struct KeyHash {
+      size_t operator()(const Key &k) const {
+        return std::hash<const void*>()(k.first.first) ^ (size_t(k.first.second) << 16) ^
+               std::hash<const void*>()(k.second.first) ^ std::hash<const void*>()(k.second.second);
+      }
+    };
+
+    Registry() { std::atexit(dump); }
+
+    static void dump() {
+      auto &registry = instance();
+      std::lock_guard<std::mutex> lock(registry.m_mutex);
+      std::map<std::string, Site> merged;
+      for (auto &entry : registry.m_sites) {
+        const Site &s = *entry.second;
+        auto &m = merged[s.file + ":" + std::to_string(s.line) + "\t" + s.container + "\t" + s.element];
+        m.instances  += s.instances;
+        m.inserts    += s.inserts;
+        m.removes    += s.removes;
+        m.lookups    += s.lookups;
+        m.iterations += s.iterations;
+        m.clears     += s.clears;
+        m.peak        = std::max(m.peak, s.peak);
+        for (int b = 0; b < Buckets; ++b) m.hist[b] += s.hist[b];
+      }
+      const char *path = std::getenv("QTOOLS_PROFILE");
+      FILE *f = std::fopen(path && *path ? path : "qtools-profile.tsv", "w");
+      if (f==nullptr) {
+        return;
+      }
+      std::fprintf(f, "site\tcontainer\telement\tinstances\tinserts\tremoves\tlookups\titerations\tclears\tpeak\tsize_hist\n");
+      for (auto &entry : merged) {
+        const Site &s = entry.second;
+        std::fprintf(f, "%s\t%ld\t%ld\t%ld\t%ld\t%ld\t%ld\t%ld\t", entry.first.c_str(),
+                     s.instances, s.inserts, s.removes, s.lookups, s.iterations, s.clears, s.peak);
+        const char *sep = "";
+        for (int b = 0; b < Buckets; ++b) {
+          if (s.hist[b]) {
+            std::fprintf(f, "%s%ld:%ld", sep, b ? 1L << (b-1) : 0L, s.hist[b]);
+            sep = ",";
+          }
+        }
+        std::fprintf(f, "\n");
+      }
+      std::fclose(f);
+    }
+
+    std::mutex m_mutex;
+    std::unordered_map<Key, Site*, KeyHash> m_sites;
+};
+
+// the per instance part, a member of every wrapper
+class Counter {
+public:
+    Counter(const char *file, int line, const char *container, const char *element)
+      : m_site(Registry::instance().site(file, line, container, element)) {
+      ++m_site->instances;
+      ++m_site->hist[0];
+    }
+
+    void insert(long size)  { ++m_site->inserts; grow(size); }
+    void remove()           { ++m_site->removes; }
+    void lookup()           { ++m_site->lookups; }
+    void iterate()          { ++m_site->iterations; }
+    void clear()            { ++m_site->clears; }
+
+    // moves the instance to the histogram bucket of its new peak size
+    void grow(long size) {
+      if (size <= m_peak) return;
+      int from = bucket(m_peak), to = bucket(size);
+      if (from != to) {
+        --m_site->hist[from];
+        ++m_site->hist[to];
+      }
+      m_peak = size;
+      if (size > m_site->peak) m_site->peak = size;
+    }
+
+private:
+    Site *m_site;
+    long m_peak = 0;
+};
+
+// iterators count a walk on the wrapper they were constructed from
+template<class Wrapper, class Orig>
+inline void iterate(const Orig &c) {
+  if (auto w = dynamic_cast<const Wrapper*>(&c)) w->profile().iterate();
+}
+
+} // namespace qprofile
+
+#define QPROFILE_SITE const char *qprofileFile = __builtin_FILE(), int qprofileLine = __builtin_LINE()
+
+#define QList QListOrig
+#define QListIterator QListIteratorOrig
+#include <qlist.h>
+#undef QList
+#undef QListIterator
+
+template<class type>
+class QList : public QListOrig<type> {
+  typedef QListOrig<type> Base;
+public:
+    explicit QList(QPROFILE_SITE) : m_profile(qprofileFile, qprofileLine, "QList", qprofile::elementName<type>()) {}
+    QList(const QList<type> &l, QPROFILE_SITE)
+      : Base(l), m_profile(qprofileFile, qprofileLine, "QList", qprofile::elementName<type>()) { m_profile.insert(Base::count()); }
+    QList<type> &operator=(const QList<type> &l) { Base::operator=(l); m_profile.insert(Base::count()); return *this; }
+
+    using Base::insert;
+    using Base::remove;
+    using Base::take;
+    using Base::find;
+    using Base::at;
+    bool  insert(uint i, const type *d)     { m_profile.insert(Base::count()+1); return Base::insert(i, d); }
+    void  inSort(const type *d)             { m_profile.insert(Base::count()+1); Base::inSort(d); }
+    void  prepend(const type *d)            { m_profile.insert(Base::count()+1); Base::prepend(d); }
+    void  append(const type *d)             { m_profile.insert(Base::count()+1); Base::append(d); }
+    bool  remove(uint i)                    { m_profile.remove(); return Base::remove(i); }
+    bool  remove()                          { m_profile.remove(); return Base::remove(); }
+    bool  remove(const type *d)             { m_profile.remove(); return Base::remove(d); }
+    bool  removeRef(const type *d)          { m_profile.remove(); return Base::removeRef(d); }
+    bool  removeFirst()                     { m_profile.remove(); return Base::removeFirst(); }
+    bool  removeLast()                      { m_profile.remove(); return Base::removeLast(); }
+    type *take(uint i)                      { m_profile.remove(); return Base::take(i); }
+    type *take()                            { m_profile.remove(); return Base::take(); }
+    void  clear()                           { m_profile.clear(); Base::clear(); }
+    int   find(const type *d)               { m_profile.lookup(); return Base::find(d); }
+    int   findRef(const type *d)            { m_profile.lookup(); return Base::findRef(d); }
+    uint  contains(const type *d) const     { m_profile.lookup(); return Base::contains(d); }
+    uint  containsRef(const type *d) const  { m_profile.lookup(); return Base::containsRef(d); }
+    type *at(uint i)                        { m_profile.lookup(); return Base::at(i); }
+
+    qprofile::Counter &profile() const { return m_profile; }
+
+private:
+    mutable qprofile::Counter m_profile;
+};
+
+template<class type>
+class QListIterator : public QListIteratorOrig<type> {
+public:
+    QListIterator(const QListOrig<type> &l) : QListIteratorOrig<type>(l) { qprofile::iterate<QList<type>>(l); }
+};
+
+#define QDict QDictOrig
+#define QDictIterator QDictIteratorOrig
+#include <qdict.h>
+#undef QDict
+#undef QDictIterator
+
+template<class type>
+class QDict : public QDictOrig<type> {
+  typedef QDictOrig<type> Base;
+public:
+    QDict(int size=17, bool caseSensitive=TRUE, QPROFILE_SITE)
+      : Base(size, caseSensitive), m_profile(qprofileFile, qprofileLine, "QDict", qprofile::elementName<type>()) {}
+    QDict(const QDict<type> &d, QPROFILE_SITE)
+      : Base(d), m_profile(qprofileFile, qprofileLine, "QDict", qprofile::elementName<type>()) { m_profile.insert(Base::count()); }
+    QDict<type> &operator=(const QDict<type> &d) { Base::operator=(d); m_profile.insert(Base::count()); return *this; }
+
+    template<class K> void  insert(const K &k, const type *d)   { Base::insert(k, d); m_profile.insert(Base::count()); }
+    template<class K> void  replace(const K &k, const type *d)  { Base::replace(k, d); m_profile.insert(Base::count()); }
+    template<class K> bool  remove(const K &k)                  { m_profile.remove(); return Base::remove(k); }
+    template<class K> type *take(const K &k)                    { m_profile.remove(); return Base::take(k); }
+    template<class K> type *find(const K &k) const              { m_profile.lookup(); return Base::find(k); }
+    template<class K> type *operator[](const K &k) const        { m_profile.lookup(); return Base::operator[](k); }
+    void  clear()                                               { m_profile.clear(); Base::clear(); }
+
+    qprofile::Counter &profile() const { return m_profile; }
+
+private:
+    mutable qprofile::Counter m_profile;
+};
+
+template<class type>
+class QDictIterator : public QDictIteratorOrig<type> {
+public:
+    QDictIterator(const QDictOrig<type> &d) : QDictIteratorOrig<type>(d) { qprofile::iterate<QDict<type>>(d); }
+};
+
+#define QIntDict QIntDictOrig
+#define QIntDictIterator QIntDictIteratorOrig
+#include <qintdict.h>
+#undef QIntDict
+#undef QIntDictIterator
+
+template<class type>
+class QIntDict : public QIntDictOrig<type> {
+  typedef QIntDictOrig<type> Base;
+public:
+    QIntDict(int size=17, QPROFILE_SITE)
+      : Base(size), m_profile(qprofileFile, qprofileLine, "QIntDict", qprofile::elementName<type>()) {}
+    QIntDict(const QIntDict<type> &d, QPROFILE_SITE)
+      : Base(d), m_profile(qprofileFile, qprofileLine, "QIntDict", qprofile::elementName<type>()) { m_profile.insert(Base::count()); }
+    QIntDict<type> &operator=(const QIntDict<type> &d) { Base::operator=(d); m_profile.insert(Base::count()); return *this; }
+
+    void  insert(long k, const type *d)   { Base::insert(k, d); m_profile.insert(Base::count()); }
+    void  replace(long k, const type *d)  { Base::replace(k, d); m_profile.insert(Base::count()); }
+    bool  remove(long k)                  { m_profile.remove(); return Base::remove(k); }
+    type *take(long k)                    { m_profile.remove(); return Base::take(k); }
+    type *find(long k) const              { m_profile.lookup(); return Base::find(k); }
+    type *operator[](long k) const        { m_profile.lookup(); return Base::operator[](k); }
+    void  clear()                         { m_profile.clear(); Base::clear(); }
+
+    qprofile::Counter &profile() const { return m_profile; }
+
+private:
+    mutable qprofile::Counter m_profile;
+};
+
+template<class type>
+class QIntDictIterator : public QIntDictIteratorOrig<type> {
+public:
+    QIntDictIterator(const QIntDictOrig<type> &d) : QIntDictIteratorOrig<type>(d) { qprofile::iterate<QIntDict<type>>(d); }
+};
+
+#define QCache QCacheOrig
+#define QCacheIterator QCacheIteratorOrig
+#include <qcache.h>
+#undef QCache
+#undef QCacheIterator
+
+template<class type>
+class QCache : public QCacheOrig<type> {
+  typedef QCacheOrig<type> Base;
+public:
+    QCache(int maxCost=100, int size=17, bool caseSensitive=TRUE, QPROFILE_SITE)
+      : Base(maxCost, size, caseSensitive), m_profile(qprofileFile, qprofileLine, "QCache", qprofile::elementName<type>()) {}
+
+    template<class K> bool  insert(const K &k, const type *d, int cost=1, int priority=0) {
+      bool inserted = Base::insert(k, d, cost, priority);
+      m_profile.insert(Base::count());
+      return inserted;
+    }
+    template<class K> bool  remove(const K &k)                 { m_profile.remove(); return Base::remove(k); }
+    template<class K> type *take(const K &k)                   { m_profile.remove(); return Base::take(k); }
+    template<class K> type *find(const K &k, bool ref=TRUE) const { m_profile.lookup(); return Base::find(k, ref); }
+    template<class K> type *operator[](const K &k) const       { m_profile.lookup(); return Base::operator[](k); }
+    void  clear()                                              { m_profile.clear(); Base::clear(); }
+
+    qprofile::Counter &profile() const { return m_profile; }
+
+private:
+    mutable qprofile::Counter m_profile;
+};
+
+template<class type>
+class QCacheIterator : public QCacheIteratorOrig<type> {
+public:
+    QCacheIterator(const QCacheOrig<type> &c) : QCacheIteratorOrig<type>(c) { qprofile::iterate<QCache<type>>(c); }
+};
+
+// doxygen's SDict (a QList for the order and a QDict for the lookup) lives
+// in src/sortdict.h, only on the include path of doxygen's own sources
+#if __has_include(<sortdict.h>)
+
+#define SDict SDictOrig
+#include <sortdict.h>
+#undef SDict
+
+template<class T>
+class SDict : public SDictOrig<T> {
+  typedef SDictOrig<T> Base;
+public:
+    SDict(int size=17, bool caseSensitive=TRUE, QPROFILE_SITE)
+      : Base(size, caseSensitive), m_profile(qprofileFile, qprofileLine, "SDict", qprofile::elementName<T>()) {}
+
+    void append(const char *key, const T *d)           { m_profile.insert(Base::count()+1); Base::append(key, d); }
+    void prepend(const char *key, const T *d)          { m_profile.insert(Base::count()+1); Base::prepend(key, d); }
+    void inSort(const char *key, const T *d)           { m_profile.insert(Base::count()+1); Base::inSort(key, d); }
+    void insertAt(int i, const char *key, const T *d)  { m_profile.insert(Base::count()+1); Base::insertAt(i, key, d); }
+    bool remove(const char *key)                       { m_profile.remove(); return Base::remove(key); }
+    T   *take(const char *key)                         { m_profile.remove(); return Base::take(key); }
+    template<class K> T *find(const K &key)            { m_profile.lookup(); return Base::find(key); }
+    template<class K> int findAt(const K &key)         { m_profile.lookup(); return Base::findAt(key); }
+    T   *operator[](const char *key) const             { m_profile.lookup(); return Base::operator[](key); }
+    T   *at(uint i)                                    { m_profile.lookup(); return Base::at(i); }
+    void clear()                                       { m_profile.clear(); Base::clear(); }
+
+    class Iterator : public Base::Iterator {
+    public:
+        Iterator(const Base &d) : Base::Iterator(d) { qprofile::iterate<SDict<T>>(d); }
+    };
+    class IteratorDict : public Base::IteratorDict {
+    public:
+        IteratorDict(const Base &d) : Base::IteratorDict(d) { qprofile::iterate<SDict<T>>(d); }
+    };
+
+    qprofile::Counter &profile() const { return m_profile; }
+
+private:
+    mutable qprofile::Counter m_profile;
+};
+
+#endif // sortdict.h
+
+#undef QPROFILE_SITE
+
+#endif // qlist.h
+#endif // __has_include
+
+#endif